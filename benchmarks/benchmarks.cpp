@@ -1,6 +1,20 @@
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <memory_resource>
+#include <mutex>
 #include <random>
+#include <shared_mutex>
+#include <sstream>
+#include <thread>
 #include <benchmark/benchmark.h>
+#include "ConcurrentQuadtree.h"
+#include "DoubleBufferedSnapshot.h"
+#include "IntersectionTracker.h"
+#include "LinearQuadtree.h"
+#include "LooseQuadtree.h"
+#include "Orthtree.h"
 #include "Quadtree.h"
 
 using namespace quadtree;
@@ -11,12 +25,21 @@ struct Node
     std::size_t id;
 };
 
-std::vector<Node> generateRandomNodes(std::size_t n)
+// Large entity whose box is far from the other members used by the simulation
+struct Entity
+{
+    std::array<char, 256> data;
+    Box<float> box;
+    std::size_t id;
+};
+
+template<typename N = Node>
+std::vector<N> generateRandomNodes(std::size_t n)
 {
     auto generator = std::default_random_engine();
     auto originDistribution = std::uniform_real_distribution(0.0f, 1.0f);
     auto sizeDistribution = std::uniform_real_distribution(0.0f, 0.01f);
-    auto nodes = std::vector<Node>(n);
+    auto nodes = std::vector<N>(n);
     for (auto i = std::size_t(0); i < n; ++i)
     {
         nodes[i].box.left = originDistribution(generator);
@@ -28,6 +51,24 @@ std::vector<Node> generateRandomNodes(std::size_t n)
     return nodes;
 }
 
+// Most nodes are small but a few are large, sizes are log-uniform between 0.0001 and 0.1
+std::vector<Node> generateSkewedNodes(std::size_t n)
+{
+    auto generator = std::default_random_engine();
+    auto originDistribution = std::uniform_real_distribution(0.0f, 1.0f);
+    auto exponentDistribution = std::uniform_real_distribution(-4.0f, -1.0f);
+    auto nodes = std::vector<Node>(n);
+    for (auto i = std::size_t(0); i < n; ++i)
+    {
+        nodes[i].box.left = originDistribution(generator);
+        nodes[i].box.top = originDistribution(generator);
+        nodes[i].box.width = std::min(1.0f - nodes[i].box.left, std::pow(10.0f, exponentDistribution(generator)));
+        nodes[i].box.height = std::min(1.0f - nodes[i].box.top, std::pow(10.0f, exponentDistribution(generator)));
+        nodes[i].id = i;
+    }
+    return nodes;
+}
+
 std::vector<Node*> query(const Box<float>& box, std::vector<Node>& nodes)
 {
     auto intersections = std::vector<Node*>();
@@ -53,6 +94,7 @@ std::vector<std::pair<Node*, Node*>> findAllIntersections(std::vector<Node>& nod
     return intersections;
 }
 
+template<typename Storage>
 void quadtreeBuild(benchmark::State& state)
 {
 
@@ -65,12 +107,55 @@ void quadtreeBuild(benchmark::State& state)
     for (auto _ : state)
     {
         auto intersections = std::vector<std::vector<Node*>>(nodes.size());
-        auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
+        auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage>(box, getBox);
         for (auto& node : nodes)
             quadtree.add(&node);
     }
 }
 
+template<typename Storage>
+void quadtreeBulkBuild(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto pointers = std::vector<Node*>();
+    for (auto& node : nodes)
+        pointers.push_back(&node);
+    for (auto _ : state)
+    {
+        auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage>(box,
+            std::begin(pointers), std::end(pointers), getBox);
+        benchmark::DoNotOptimize(quadtree);
+    }
+}
+
+void quadtreeBulkBuildInParallel(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range(0)));
+    auto pointers = std::vector<Node*>();
+    for (auto& node : nodes)
+        pointers.push_back(&node);
+    auto pool = ThreadPool(static_cast<std::size_t>(state.range(1)));
+    for (auto _ : state)
+    {
+        auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage>(box,
+            std::begin(pointers), std::end(pointers), pool, getBox);
+        benchmark::DoNotOptimize(quadtree);
+    }
+}
+
+template<typename Storage>
 void quadtreeQuery(benchmark::State& state)
 {
 
@@ -84,7 +169,7 @@ void quadtreeQuery(benchmark::State& state)
     for (auto _ : state)
     {
         auto intersections = std::vector<std::vector<Node*>>(nodes.size());
-        auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
+        auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage>(box, getBox);
         for (auto& node : nodes)
             quadtree.add(&node);
         for (const auto& node : nodes)
@@ -92,6 +177,7 @@ void quadtreeQuery(benchmark::State& state)
     }
 }
 
+template<typename Storage>
 void quadtreeFindAllIntersections(benchmark::State& state)
 {
 
@@ -103,13 +189,866 @@ void quadtreeFindAllIntersections(benchmark::State& state)
     auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
     for (auto _ : state)
     {
-        auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
+        auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage>(box, getBox);
         for (auto& node : nodes)
             quadtree.add(&node);
         auto intersections = quadtree.findAllIntersections();
     }
 }
 
+template<typename Storage>
+void quadtreeAddRemove(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    for (auto _ : state)
+    {
+        // Remove then add back half of the nodes to trigger merges and splits
+        for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+            quadtree.remove(&nodes[i]);
+        for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+            quadtree.add(&nodes[i]);
+    }
+}
+
+template<bool CacheBoxes>
+void quadtreeQueryExpensiveGetBox(benchmark::State& state)
+{
+
+    auto getBox = [](const Entity* entity)
+    {
+        return entity->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto entities = generateRandomNodes<Entity>(static_cast<std::size_t>(state.range()));
+    auto quadtree = Quadtree<const Entity*, decltype(getBox), std::equal_to<const Entity*>, float, PooledStorage,
+        CacheBoxes>(box, getBox);
+    for (const auto& entity : entities)
+        quadtree.add(&entity);
+    for (auto _ : state)
+    {
+        for (const auto& entity : entities)
+            benchmark::DoNotOptimize(quadtree.query(entity.box));
+    }
+}
+
+template<bool CacheBoxes>
+void quadtreeFindAllIntersectionsExpensiveGetBox(benchmark::State& state)
+{
+
+    auto getBox = [](const Entity* entity)
+    {
+        return entity->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto entities = generateRandomNodes<Entity>(static_cast<std::size_t>(state.range()));
+    auto quadtree = Quadtree<const Entity*, decltype(getBox), std::equal_to<const Entity*>, float, PooledStorage,
+        CacheBoxes>(box, getBox);
+    for (const auto& entity : entities)
+        quadtree.add(&entity);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(quadtree.findAllIntersections());
+}
+
+template<bool CacheBoxes>
+void quadtreeQueryCount(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, CacheBoxes>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    for (auto _ : state)
+    {
+        auto count = std::size_t(0);
+        for (const auto& node : nodes)
+            quadtree.query(node.box, [&count](Node*){ ++count; });
+        benchmark::DoNotOptimize(count);
+    }
+}
+
+template<bool CacheBoxes>
+void quadtreeQueryCountWithVector(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, CacheBoxes>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    for (auto _ : state)
+    {
+        auto count = std::size_t(0);
+        for (const auto& node : nodes)
+            count += quadtree.query(node.box).size();
+        benchmark::DoNotOptimize(count);
+    }
+}
+
+void quadtreeFindAllIntersectionsInParallel(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range(0)));
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, true>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto pool = ThreadPool(static_cast<std::size_t>(state.range(1)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(quadtree.findAllIntersections(pool));
+}
+
+void quadtreeQueryBatch(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range(0)));
+    using NodeQuadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, true>;
+    auto quadtree = NodeQuadtree(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Shuffle the boxes so that the order of the queries is not already spatially coherent
+    auto boxes = std::vector<Box<float>>();
+    for (const auto& node : nodes)
+        boxes.push_back(node.box);
+    std::shuffle(std::begin(boxes), std::end(boxes), std::default_random_engine());
+    auto pool = ThreadPool(static_cast<std::size_t>(state.range(1)));
+    auto result = NodeQuadtree::QueryBatchResult();
+    for (auto _ : state)
+    {
+        quadtree.queryBatch(boxes, pool, result);
+        benchmark::DoNotOptimize(result.getValues().data());
+    }
+}
+
+void linearQuadtreeBuild(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto pointers = std::vector<Node*>();
+    for (auto& node : nodes)
+        pointers.push_back(&node);
+    for (auto _ : state)
+    {
+        auto quadtree = LinearQuadtree<Node*, decltype(getBox)>(box, std::begin(pointers), std::end(pointers), getBox);
+        benchmark::DoNotOptimize(quadtree);
+    }
+}
+
+void linearQuadtreeQuery(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto pointers = std::vector<Node*>();
+    for (auto& node : nodes)
+        pointers.push_back(&node);
+    auto quadtree = LinearQuadtree<Node*, decltype(getBox)>(box, std::begin(pointers), std::end(pointers), getBox);
+    for (auto _ : state)
+    {
+        auto intersections = std::vector<std::vector<Node*>>(nodes.size());
+        for (const auto& node : nodes)
+            intersections[node.id] = quadtree.query(node.box);
+    }
+}
+
+void linearQuadtreeFindAllIntersections(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto pointers = std::vector<Node*>();
+    for (auto& node : nodes)
+        pointers.push_back(&node);
+    auto quadtree = LinearQuadtree<Node*, decltype(getBox)>(box, std::begin(pointers), std::end(pointers), getBox);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(quadtree.findAllIntersections());
+}
+
+// The kernel is skipped if isSupported() returns false, i.e. if the CPU does not
+// support its instruction set
+void findIntersectingBoundsKernel(benchmark::State& state, FindIntersectingBoundsKernel kernel,
+    bool (*isSupported)())
+{
+    if (!isSupported())
+    {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto lefts = std::vector<float>();
+    auto tops = std::vector<float>();
+    auto rights = std::vector<float>();
+    auto bottoms = std::vector<float>();
+    for (const auto& node : nodes)
+    {
+        lefts.push_back(node.box.left);
+        tops.push_back(node.box.top);
+        rights.push_back(node.box.getRight());
+        bottoms.push_back(node.box.getBottom());
+    }
+    auto boxes = BoundsArrays<float>{lefts.data(), tops.data(), rights.data(), bottoms.data()};
+    auto indices = std::vector<std::size_t>(nodes.size());
+    for (auto _ : state)
+    {
+        for (const auto& node : nodes)
+            benchmark::DoNotOptimize(kernel(Bounds<float>::fromBox(node.box), boxes, 0, nodes.size(), indices.data()));
+    }
+}
+
+// Move 90% of the nodes by a tiny amount with update or with remove and add
+template<bool Update>
+void quadtreeMove(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, true>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto generator = std::default_random_engine();
+    auto moveDistribution = std::uniform_real_distribution(-0.001f, 0.001f);
+    auto staticDistribution = std::uniform_int_distribution(0, 9);
+    for (auto _ : state)
+    {
+        for (auto& node : nodes)
+        {
+            if (staticDistribution(generator) == 0)
+                continue;
+            auto oldBox = node.box;
+            if constexpr (!Update)
+                quadtree.remove(&node);
+            node.box.left = std::clamp(node.box.left + moveDistribution(generator), 0.0f, 1.0f - node.box.width);
+            node.box.top = std::clamp(node.box.top + moveDistribution(generator), 0.0f, 1.0f - node.box.height);
+            if constexpr (Update)
+                quadtree.update(&node, oldBox);
+            else
+                quadtree.add(&node);
+        }
+    }
+}
+
+// Find the pairs of a frame where 5% of the nodes move, with findAllIntersections
+// or with the changes of pairs found by an IntersectionTracker
+template<bool Incremental>
+void quadtreeFramePairs(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, true>(box, getBox);
+    auto values = std::vector<Node*>();
+    for (auto& node : nodes)
+    {
+        quadtree.add(&node);
+        values.push_back(&node);
+    }
+    auto tracker = IntersectionTracker<Node*>();
+    auto addedPairs = std::vector<std::pair<Node*, Node*>>();
+    auto removedPairs = std::vector<std::pair<Node*, Node*>>();
+    tracker.update(quadtree, std::begin(values), std::end(values), std::back_inserter(addedPairs),
+        std::back_inserter(removedPairs));
+    auto generator = std::default_random_engine();
+    auto moveDistribution = std::uniform_real_distribution(-0.001f, 0.001f);
+    auto movingDistribution = std::uniform_int_distribution(0, 19);
+    auto movedValues = std::vector<Node*>();
+    for (auto _ : state)
+    {
+        movedValues.clear();
+        for (auto& node : nodes)
+        {
+            if (movingDistribution(generator) != 0)
+                continue;
+            auto oldBox = node.box;
+            node.box.left = std::clamp(node.box.left + moveDistribution(generator), 0.0f, 1.0f - node.box.width);
+            node.box.top = std::clamp(node.box.top + moveDistribution(generator), 0.0f, 1.0f - node.box.height);
+            quadtree.update(&node, oldBox);
+            movedValues.push_back(&node);
+        }
+        if constexpr (Incremental)
+        {
+            addedPairs.clear();
+            removedPairs.clear();
+            tracker.update(quadtree, std::begin(movedValues), std::end(movedValues), std::back_inserter(addedPairs),
+                std::back_inserter(removedPairs));
+            benchmark::DoNotOptimize(addedPairs);
+        }
+        else
+            benchmark::DoNotOptimize(quadtree.findAllIntersections());
+    }
+}
+
+// Find the 8 nearest values of each node
+void quadtreeFindNearest(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, true>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    for (auto _ : state)
+    {
+        for (const auto& node : nodes)
+            benchmark::DoNotOptimize(quadtree.findNearest(node.box.getCenter(), 8));
+    }
+}
+
+// Find the first hit of 1000 long rays with raycast or by querying the box of
+// the segment and testing the candidates
+template<bool Raycast>
+void quadtreeRaycast(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, true>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto generator = std::default_random_engine();
+    auto positionDistribution = std::uniform_real_distribution(0.0f, 1.0f);
+    auto rays = std::vector<std::pair<Vector2<float>, Vector2<float>>>();
+    for (auto i = std::size_t(0); i < 1000; ++i)
+    {
+        auto origin = Vector2<float>(positionDistribution(generator), positionDistribution(generator));
+        auto end = Vector2<float>(positionDistribution(generator), positionDistribution(generator));
+        rays.emplace_back(origin, Vector2<float>(end.x - origin.x, end.y - origin.y));
+    }
+    for (auto _ : state)
+    {
+        for (const auto& [origin, direction] : rays)
+        {
+            if constexpr (Raycast)
+                benchmark::DoNotOptimize(quadtree.raycast(origin, direction, 1.0f));
+            else
+            {
+                auto segmentBox = Box(std::min(origin.x, origin.x + direction.x), std::min(origin.y, origin.y + direction.y),
+                    std::abs(direction.x), std::abs(direction.y));
+                auto hit = static_cast<Node*>(nullptr);
+                auto hitT = std::numeric_limits<float>::max();
+                quadtree.query(segmentBox, [&](Node* node)
+                {
+                    auto t = 0.0f;
+                    if (Bounds<float>::fromBox(node->box).intersects(origin, direction, 1.0f, t) && t < hitT)
+                    {
+                        hit = node;
+                        hitT = t;
+                    }
+                });
+                benchmark::DoNotOptimize(hit);
+            }
+        }
+    }
+}
+
+// Query the box of each node and find all intersections on nodes of skewed
+// sizes with Quadtree or LooseQuadtree
+template<bool Loose>
+void quadtreeSkewedQueryAndFindAllIntersections(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateSkewedNodes(static_cast<std::size_t>(state.range()));
+    using QuadtreeType = std::conditional_t<Loose,
+        LooseQuadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage>,
+        Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, true>>;
+    auto quadtree = QuadtreeType(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    for (auto _ : state)
+    {
+        auto nbIntersections = std::size_t(0);
+        for (const auto& node : nodes)
+            quadtree.query(node.box, [&nbIntersections](Node*){ ++nbIntersections; });
+        quadtree.findAllIntersections([&nbIntersections](Node*, Node*){ ++nbIntersections; });
+        benchmark::DoNotOptimize(nbIntersections);
+    }
+}
+
+// Snapshot of a quadtree in a buffer aligned for SnapshotQuadtree
+struct alignas(SnapshotAlignment) SnapshotBlock
+{
+    char bytes[SnapshotAlignment];
+};
+
+template<typename Quadtree>
+std::vector<SnapshotBlock> writeSnapshot(const Quadtree& quadtree, std::size_t& size)
+{
+    auto out = std::ostringstream();
+    quadtree.writeSnapshot(out);
+    auto data = out.str();
+    auto buffer = std::vector<SnapshotBlock>(data.size() / sizeof(SnapshotBlock) + 1);
+    std::memcpy(buffer.data(), data.data(), data.size());
+    size = data.size();
+    return buffer;
+}
+
+// Load a snapshot and query the box of each node
+void snapshotLoadAndQuery(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto size = std::size_t(0);
+    auto buffer = writeSnapshot(quadtree, size);
+    for (auto _ : state)
+    {
+        auto snapshot = SnapshotQuadtree<Node*>(buffer.data(), size);
+        auto intersections = std::vector<std::vector<Node*>>(nodes.size());
+        for (const auto& node : nodes)
+            intersections[node.id] = snapshot.query(node.box);
+    }
+}
+
+// Query the box of each node from several readers while a writer keeps adding
+// and removing nodes, the baseline protects a Quadtree with a shared mutex
+template<bool Concurrent>
+void quadtreeConcurrentQuery(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range(0)));
+    auto nbReaders = static_cast<std::size_t>(state.range(1));
+    auto quadtree = std::conditional_t<Concurrent, ConcurrentQuadtree<Node*, decltype(getBox)>,
+        Quadtree<Node*, decltype(getBox)>>(box, getBox);
+    auto mutex = std::shared_mutex();
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Writer
+    auto done = std::atomic<bool>(false);
+    auto writer = std::thread([&]()
+    {
+        auto generator = std::default_random_engine();
+        auto nodeDistribution = std::uniform_int_distribution(std::size_t(0), nodes.size() - 1);
+        while (!done.load())
+        {
+            auto node = &nodes[nodeDistribution(generator)];
+            if constexpr (Concurrent)
+            {
+                quadtree.remove(node);
+                quadtree.add(node);
+            }
+            else
+            {
+                auto lock = std::unique_lock(mutex);
+                quadtree.remove(node);
+                quadtree.add(node);
+            }
+        }
+    });
+    // Readers
+    for (auto _ : state)
+    {
+        auto readers = std::vector<std::thread>();
+        for (auto i = std::size_t(0); i < nbReaders; ++i)
+        {
+            readers.emplace_back([&]()
+            {
+                auto nbIntersections = std::size_t(0);
+                auto count = [&nbIntersections](Node*){ ++nbIntersections; };
+                for (const auto& node : nodes)
+                {
+                    if constexpr (Concurrent)
+                        quadtree.query(node.box, count);
+                    else
+                    {
+                        auto lock = std::shared_lock(mutex);
+                        quadtree.query(node.box, count);
+                    }
+                }
+                benchmark::DoNotOptimize(nbIntersections);
+            });
+        }
+        for (auto& reader : readers)
+            reader.join();
+    }
+    done.store(true);
+    writer.join();
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(nodes.size() * nbReaders));
+}
+
+// Publish a snapshot of the tree for the readers of the next tick, by
+// rebuilding double buffered snapshots or by building new buffers each time
+template<bool Reuse>
+void quadtreePublishSnapshot(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, true>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto snapshot = DoubleBufferedSnapshot<Node*>(box);
+    for (auto _ : state)
+    {
+        if constexpr (Reuse)
+            snapshot.publish(quadtree);
+        else
+        {
+            auto buffers = SnapshotBuffers<Node*, float>();
+            quadtree.buildSnapshot(buffers);
+            benchmark::DoNotOptimize(buffers.nodes.data());
+        }
+    }
+}
+
+// Build a tree whose nodes and values are allocated with allocator, query the
+// box of each node and remove half of the nodes
+template<typename Allocator>
+void buildQueryAndRemove(std::vector<Node>& nodes, const Allocator& allocator)
+{
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PointerStorage, true,
+        StaticParameters<>, Allocator>(box, getBox, std::equal_to<Node*>(), StaticParameters<>(), allocator);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto nbIntersections = std::size_t(0);
+    for (const auto& node : nodes)
+        quadtree.query(node.box, [&nbIntersections](Node*){ ++nbIntersections; });
+    benchmark::DoNotOptimize(nbIntersections);
+    for (auto i = std::size_t(0); i < nodes.size(); i += 2)
+        quadtree.remove(&nodes[i]);
+}
+
+void quadtreeBuildQueryRemove(benchmark::State& state)
+{
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    for (auto _ : state)
+        buildQueryAndRemove(nodes, std::allocator<Node*>());
+}
+
+// Same as above but with a new memory resource for each tree
+template<typename Resource>
+void quadtreeBuildQueryRemoveWithResource(benchmark::State& state)
+{
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    for (auto _ : state)
+    {
+        auto resource = Resource();
+        buildQueryAndRemove(nodes, std::pmr::polymorphic_allocator<Node*>(&resource));
+    }
+}
+
+// Remove and add back the nodes of a dense cluster whose nodes all end up in
+// the same node at the maximum depth, by value or by handle
+template<bool UseHandles>
+void quadtreeDenseClusterRemove(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    for (auto& node : nodes)
+    {
+        node.box.left = 0.5f + node.box.left * 0.0001f;
+        node.box.top = 0.5f + node.box.top * 0.0001f;
+        node.box.width *= 0.0001f;
+        node.box.height *= 0.0001f;
+    }
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, true,
+        StaticParameters<>, std::allocator<Node*>, UseHandles>(box, getBox);
+    auto handles = std::vector<Handle>();
+    for (auto& node : nodes)
+    {
+        if constexpr (UseHandles)
+            handles.push_back(quadtree.add(&node));
+        else
+            quadtree.add(&node);
+    }
+    for (auto _ : state)
+    {
+        for (auto& node : nodes)
+        {
+            if constexpr (UseHandles)
+            {
+                quadtree.remove(handles[node.id]);
+                handles[node.id] = quadtree.add(&node);
+            }
+            else
+            {
+                quadtree.remove(&node);
+                quadtree.add(&node);
+            }
+        }
+    }
+}
+
+template<bool CacheBoxes>
+void quadtreeDeepQueryAndFindAllIntersections(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    // Small threshold so that the tree is deep
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, CacheBoxes,
+        StaticParameters<2, 12>>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    for (auto _ : state)
+    {
+        auto count = std::size_t(0);
+        for (const auto& node : nodes)
+            quadtree.query(node.box, [&count](Node*){ ++count; });
+        quadtree.findAllIntersections([&count](Node*, Node*){ ++count; });
+        benchmark::DoNotOptimize(count);
+    }
+}
+
+// A dense cluster whose values all end up in the same node at the maximum
+// depth, and as many values crossing the horizontal center line that stay in
+// the root
+template<bool CacheBoxes>
+void quadtreeClusterFindAllIntersections(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto n = static_cast<std::size_t>(state.range());
+    auto nodes = generateRandomNodes(2 * n);
+    for (auto i = std::size_t(0); i < n; ++i)
+    {
+        nodes[i].box.left = 0.5f + nodes[i].box.left * 0.0001f;
+        nodes[i].box.top = 0.5f + nodes[i].box.top * 0.0001f;
+        nodes[i].box.width *= 0.001f;
+        nodes[i].box.height *= 0.001f;
+        nodes[n + i].box.top = 0.5f - nodes[n + i].box.height * 0.5f;
+    }
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, CacheBoxes>(
+        box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    for (auto _ : state)
+    {
+        auto count = std::size_t(0);
+        quadtree.findAllIntersections([&count](Node*, Node*){ ++count; });
+        benchmark::DoNotOptimize(count);
+    }
+}
+
+// Contacts between static geometry and actors stored in two trees, with one
+// query per actor or with a join of the trees
+template<bool Join>
+void quadtreeStaticDynamicContacts(benchmark::State& state)
+{
+
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto n = static_cast<std::size_t>(state.range());
+    auto staticNodes = generateRandomNodes(n);
+    auto actors = generateRandomNodes(2 * n);
+    actors.erase(std::begin(actors), std::begin(actors) + static_cast<std::ptrdiff_t>(n));
+    using QuadtreeType = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, true>;
+    auto staticQuadtree = QuadtreeType(box, getBox);
+    for (auto& node : staticNodes)
+        staticQuadtree.add(&node);
+    auto dynamicQuadtree = QuadtreeType(box, getBox);
+    for (auto& actor : actors)
+        dynamicQuadtree.add(&actor);
+    for (auto _ : state)
+    {
+        auto count = std::size_t(0);
+        if constexpr (Join)
+            dynamicQuadtree.findIntersections(staticQuadtree, [&count](Node*, Node*){ ++count; });
+        else
+        {
+            for (auto& actor : actors)
+                staticQuadtree.query(actor.box, [&count](Node*){ ++count; });
+        }
+        benchmark::DoNotOptimize(count);
+    }
+}
+
+// Build, query and find all intersections with the same nodes in
+// coordinates of type Float, integer coordinates are fixed-point with 40
+// fractional bits
+template<typename Float>
+void quadtreeCoordinates(benchmark::State& state)
+{
+    struct FloatNode
+    {
+        Box<Float> box;
+        std::size_t id;
+    };
+    auto getBox = [](FloatNode* node)
+    {
+        return node->box;
+    };
+    auto scale = std::is_integral_v<Float> ? static_cast<double>(std::int64_t(1) << 40) : 1.0;
+    auto toFloat = [scale](float x){ return static_cast<Float>(static_cast<double>(x) * scale); };
+    auto box = Box<Float>(0, 0, toFloat(1.0f), toFloat(1.0f));
+    auto nodes = std::vector<FloatNode>();
+    for (const auto& node : generateRandomNodes(static_cast<std::size_t>(state.range())))
+    {
+        nodes.push_back(FloatNode{Box<Float>(toFloat(node.box.left), toFloat(node.box.top), toFloat(node.box.width),
+            toFloat(node.box.height)), node.id});
+    }
+    for (auto _ : state)
+    {
+        auto quadtree = Quadtree<FloatNode*, decltype(getBox), std::equal_to<FloatNode*>, Float>(box, getBox);
+        for (auto& node : nodes)
+            quadtree.add(&node);
+        auto count = std::size_t(0);
+        for (const auto& node : nodes)
+            quadtree.query(node.box, [&count](FloatNode*){ ++count; });
+        quadtree.findAllIntersections([&count](FloatNode*, FloatNode*){ ++count; });
+        benchmark::DoNotOptimize(count);
+    }
+}
+
+template<std::size_t D>
+struct OrthtreeNode
+{
+    Box<float, D> box;
+    std::size_t id;
+};
+
+template<std::size_t D>
+struct GetOrthtreeBox
+{
+    Box<float, D> operator()(OrthtreeNode<D>* node) const
+    {
+        return node->box;
+    }
+};
+
+// Build, query and find all intersections in dimension D, the volume of the
+// boxes is the same in all dimensions
+template<std::size_t D, typename Tree>
+void buildQueryFindAllIntersections(benchmark::State& state)
+{
+    auto position = Vector<float, D>();
+    auto size = Vector<float, D>();
+    for (auto axis = std::size_t(0); axis < D; ++axis)
+        size[axis] = 1.0f;
+    auto box = Box<float, D>(position, size);
+    auto generator = std::default_random_engine();
+    auto originDistribution = std::uniform_real_distribution(0.0f, 1.0f);
+    auto sizeDistribution = std::uniform_real_distribution(0.0f, std::pow(0.0001f, 1.0f / static_cast<float>(D)));
+    auto nodes = std::vector<OrthtreeNode<D>>(static_cast<std::size_t>(state.range()));
+    for (auto i = std::size_t(0); i < nodes.size(); ++i)
+    {
+        for (auto axis = std::size_t(0); axis < D; ++axis)
+        {
+            position[axis] = originDistribution(generator);
+            size[axis] = std::min(1.0f - position[axis], sizeDistribution(generator));
+        }
+        nodes[i] = OrthtreeNode<D>{Box<float, D>(position, size), i};
+    }
+    for (auto _ : state)
+    {
+        auto tree = Tree(box, GetOrthtreeBox<D>());
+        for (auto& node : nodes)
+            tree.add(&node);
+        auto count = std::size_t(0);
+        for (const auto& node : nodes)
+            tree.query(node.box, [&count](OrthtreeNode<D>*){ ++count; });
+        tree.findAllIntersections([&count](OrthtreeNode<D>*, OrthtreeNode<D>*){ ++count; });
+        benchmark::DoNotOptimize(count);
+    }
+}
+
+template<std::size_t D>
+void orthtreeBuildQueryFindAllIntersections(benchmark::State& state)
+{
+    buildQueryFindAllIntersections<D, Orthtree<OrthtreeNode<D>*, GetOrthtreeBox<D>, D>>(state);
+}
+
+// Same as orthtreeBuildQueryFindAllIntersections<2> with Quadtree
+void quadtreeBuildQueryFindAllIntersections(benchmark::State& state)
+{
+    buildQueryFindAllIntersections<2, Quadtree<OrthtreeNode<2>*, GetOrthtreeBox<2>>>(state);
+}
+
 void bruteForceQuery(benchmark::State& state)
 {
     auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
@@ -130,10 +1069,88 @@ void bruteForceFindAllIntersections(benchmark::State& state)
     }
 }
 
-BENCHMARK(quadtreeBuild)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
-BENCHMARK(quadtreeQuery)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
-BENCHMARK(quadtreeFindAllIntersections)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+void bruteForceFindNearest(benchmark::State& state)
+{
+    auto nodes = generateRandomNodes(static_cast<std::size_t>(state.range()));
+    auto distances = std::vector<std::pair<float, Node*>>(nodes.size());
+    for (auto _ : state)
+    {
+        for (const auto& node : nodes)
+        {
+            auto point = node.box.getCenter();
+            for (auto i = std::size_t(0); i < nodes.size(); ++i)
+                distances[i] = std::pair(Bounds<float>::fromBox(nodes[i].box).getDistance(point), &nodes[i]);
+            auto k = std::min(nodes.size(), std::size_t(8));
+            std::partial_sort(std::begin(distances), std::begin(distances) + static_cast<std::ptrdiff_t>(k),
+                std::end(distances));
+            benchmark::DoNotOptimize(distances.data());
+        }
+    }
+}
+
+BENCHMARK_TEMPLATE(quadtreeBuild, PointerStorage)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeQuery, PointerStorage)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeFindAllIntersections, PointerStorage)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeAddRemove, PointerStorage)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeBuild, PooledStorage)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeBulkBuild, PointerStorage)->RangeMultiplier(10)->Range(100, 1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeBulkBuild, PooledStorage)->RangeMultiplier(10)->Range(100, 1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(quadtreeBulkBuildInParallel)->ArgsProduct({{100000, 1000000}, {1, 2, 4, 8, 16, 32}})->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeQuery, PooledStorage)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeFindAllIntersections, PooledStorage)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeAddRemove, PooledStorage)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeQueryExpensiveGetBox, false)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeQueryExpensiveGetBox, true)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeFindAllIntersectionsExpensiveGetBox, false)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeFindAllIntersectionsExpensiveGetBox, true)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeQueryCount, false)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeQueryCount, true)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeQueryCountWithVector, false)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeQueryCountWithVector, true)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(quadtreeFindAllIntersectionsInParallel)->ArgsProduct({{10000, 100000, 1000000}, {1, 2, 4, 8, 16, 32}})->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(quadtreeQueryBatch)->ArgsProduct({{10000, 100000}, {1, 2, 4, 8, 16, 32}})->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(linearQuadtreeBuild)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(linearQuadtreeQuery)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(linearQuadtreeFindAllIntersections)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(findIntersectingBoundsKernel, scalar, &findIntersectingBoundsScalar<float>, []{ return true; })->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+#ifdef QUADTREE_SIMD_X86
+BENCHMARK_CAPTURE(findIntersectingBoundsKernel, sse, &findIntersectingBoundsSse, []{ return __builtin_cpu_supports("sse2") != 0; })->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(findIntersectingBoundsKernel, avx2, &findIntersectingBoundsAvx2, []{ return __builtin_cpu_supports("avx2") != 0; })->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(findIntersectingBoundsKernel, avx512, &findIntersectingBoundsAvx512, []{ return __builtin_cpu_supports("avx512f") != 0; })->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+#endif
+BENCHMARK_TEMPLATE(quadtreeMove, false)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeMove, true)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeFramePairs, false)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeFramePairs, true)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(quadtreeFindNearest)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeRaycast, false)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeRaycast, true)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeSkewedQueryAndFindAllIntersections, false)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeSkewedQueryAndFindAllIntersections, true)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(snapshotLoadAndQuery)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeConcurrentQuery, false)->ArgsProduct({{10000, 100000}, {1, 2, 4, 8, 16}})->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeConcurrentQuery, true)->ArgsProduct({{10000, 100000}, {1, 2, 4, 8, 16}})->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreePublishSnapshot, false)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreePublishSnapshot, true)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(quadtreeBuildQueryRemove)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeBuildQueryRemoveWithResource, std::pmr::monotonic_buffer_resource)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeBuildQueryRemoveWithResource, std::pmr::unsynchronized_pool_resource)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeDenseClusterRemove, false)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeDenseClusterRemove, true)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeDeepQueryAndFindAllIntersections, false)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeDeepQueryAndFindAllIntersections, true)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeClusterFindAllIntersections, false)->RangeMultiplier(2)->Range(8, 4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeClusterFindAllIntersections, true)->RangeMultiplier(2)->Range(8, 4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeStaticDynamicContacts, false)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeStaticDynamicContacts, true)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeCoordinates, float)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeCoordinates, double)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(quadtreeCoordinates, std::int64_t)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(orthtreeBuildQueryFindAllIntersections, 2)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(quadtreeBuildQueryFindAllIntersections)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(orthtreeBuildQueryFindAllIntersections, 3)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
 BENCHMARK(bruteForceQuery)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
 BENCHMARK(bruteForceFindAllIntersections)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bruteForceFindNearest)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
 
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Quadtree.h"
+
+// Sweep the threshold and the maximum depth of the tree on several
+// distributions of boxes and report the fastest parameters for each of them
+// Usage: tuning [number of boxes]
+
+using namespace quadtree;
+
+struct Node
+{
+    Box<float> box;
+    std::size_t id;
+};
+
+struct Distribution
+{
+    std::string name;
+    std::function<std::vector<Node>(std::size_t)> generate;
+};
+
+// Boxes with a top left corner given by generatePosition and a size given by generateSize
+template<typename GeneratePosition, typename GenerateSize>
+std::vector<Node> generateNodes(std::size_t n, GeneratePosition generatePosition, GenerateSize generateSize)
+{
+    auto generator = std::default_random_engine();
+    auto nodes = std::vector<Node>(n);
+    for (auto i = std::size_t(0); i < n; ++i)
+    {
+        auto [left, top] = generatePosition(generator);
+        nodes[i].box.left = std::clamp(left, 0.0f, 1.0f);
+        nodes[i].box.top = std::clamp(top, 0.0f, 1.0f);
+        nodes[i].box.width = std::min(1.0f - nodes[i].box.left, generateSize(generator));
+        nodes[i].box.height = std::min(1.0f - nodes[i].box.top, generateSize(generator));
+        nodes[i].id = i;
+    }
+    return nodes;
+}
+
+std::vector<Distribution> createDistributions()
+{
+    auto uniformPosition = [](std::default_random_engine& generator)
+    {
+        auto distribution = std::uniform_real_distribution(0.0f, 1.0f);
+        return std::pair(distribution(generator), distribution(generator));
+    };
+    auto clusteredPosition = [](std::default_random_engine& generator)
+    {
+        // 16 clusters on a grid
+        auto clusterDistribution = std::uniform_int_distribution(0, 15);
+        auto offsetDistribution = std::normal_distribution(0.0f, 0.02f);
+        auto cluster = clusterDistribution(generator);
+        return std::pair(0.125f + 0.25f * static_cast<float>(cluster % 4) + offsetDistribution(generator),
+            0.125f + 0.25f * static_cast<float>(cluster / 4) + offsetDistribution(generator));
+    };
+    auto uniformSize = [](std::default_random_engine& generator)
+    {
+        return std::uniform_real_distribution(0.0f, 0.01f)(generator);
+    };
+    auto skewedSize = [](std::default_random_engine& generator)
+    {
+        // Most boxes are small but a few are large
+        auto exponent = std::uniform_real_distribution(-4.0f, -1.0f)(generator);
+        return std::pow(10.0f, exponent);
+    };
+    auto tinySize = [](std::default_random_engine& generator)
+    {
+        return std::uniform_real_distribution(0.0f, 0.00001f)(generator);
+    };
+    return {
+        {"uniform", [=](std::size_t n){ return generateNodes(n, uniformPosition, uniformSize); }},
+        {"clustered", [=](std::size_t n){ return generateNodes(n, clusteredPosition, uniformSize); }},
+        {"skewed sizes", [=](std::size_t n){ return generateNodes(n, uniformPosition, skewedSize); }},
+        {"tiny", [=](std::size_t n){ return generateNodes(n, uniformPosition, tinySize); }}
+    };
+}
+
+// Time in milliseconds to add all the nodes, query the box of each of them and find all intersections
+double measure(std::vector<Node>& nodes, const DynamicParameters& parameters)
+{
+    auto getBox = [](Node* node)
+    {
+        return node->box;
+    };
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto start = std::chrono::steady_clock::now();
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, true,
+        DynamicParameters>(box, getBox, std::equal_to<Node*>(), parameters);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto nbIntersections = std::size_t(0);
+    for (const auto& node : nodes)
+        quadtree.query(node.box, [&nbIntersections](Node*){ ++nbIntersections; });
+    quadtree.findAllIntersections([&nbIntersections](Node*, Node*){ ++nbIntersections; });
+    auto end = std::chrono::steady_clock::now();
+    // Prevent the traversals from being optimized away
+    if (nbIntersections == 0)
+        std::cerr << "No intersection\n";
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    auto n = argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : std::size_t(100000);
+    auto thresholds = {std::size_t(4), std::size_t(8), std::size_t(16), std::size_t(32), std::size_t(64),
+        std::size_t(128)};
+    auto maxDepths = {std::size_t(4), std::size_t(6), std::size_t(8), std::size_t(10), std::size_t(12),
+        std::size_t(14), std::size_t(16)};
+    constexpr auto NbRuns = 3;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& distribution : createDistributions())
+    {
+        auto nodes = distribution.generate(n);
+        std::cout << distribution.name << " (" << n << " boxes, time in ms)\n";
+        std::cout << std::setw(10) << "threshold";
+        for (auto maxDepth : maxDepths)
+            std::cout << std::setw(10) << maxDepth;
+        std::cout << '\n';
+        auto best = DynamicParameters();
+        auto bestTime = std::numeric_limits<double>::max();
+        for (auto threshold : thresholds)
+        {
+            std::cout << std::setw(10) << threshold;
+            for (auto maxDepth : maxDepths)
+            {
+                // Keep the fastest run to reduce noise
+                auto parameters = DynamicParameters(threshold, maxDepth);
+                auto time = std::numeric_limits<double>::max();
+                for (auto i = 0; i < NbRuns; ++i)
+                    time = std::min(time, measure(nodes, parameters));
+                std::cout << std::setw(10) << time << std::flush;
+                if (time < bestTime)
+                {
+                    best = parameters;
+                    bestTime = time;
+                }
+            }
+            std::cout << '\n';
+        }
+        std::cout << "best: threshold = " << best.getThreshold() << ", max depth = " << best.getMaxDepth() <<
+            " (" << bestTime << " ms)\n\n";
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include "Box.h"
+
+namespace quadtree
+{
+
+// Box described by its lower and upper corners, intersection tests on bounds
+// give the same results as on the boxes they are built from, the bounds of
+// dimension 2 name their sides
+template<typename Float, std::size_t D = 2>
+struct Bounds
+{
+    Vector<Float, D> lower;
+    Vector<Float, D> upper;
+
+    static constexpr Bounds fromBox(const Box<Float, D>& box) noexcept
+    {
+        return Bounds{box.getPosition(), box.getPosition() + box.getSize()};
+    }
+
+    constexpr Vector<Float, D> getLower() const noexcept
+    {
+        return lower;
+    }
+
+    constexpr Vector<Float, D> getUpper() const noexcept
+    {
+        return upper;
+    }
+
+    constexpr bool intersects(const Bounds& bounds) const noexcept
+    {
+        for (auto axis = std::size_t(0); axis < D; ++axis)
+        {
+            if (lower[axis] >= bounds.upper[axis] || upper[axis] <= bounds.lower[axis])
+                return false;
+        }
+        return true;
+    }
+};
+
+template<typename Float>
+struct Bounds<Float, 2>
+{
+    Float left;
+    Float top;
+    Float right;
+    Float bottom;
+
+    static constexpr Bounds fromBox(const Box<Float>& box) noexcept
+    {
+        return Bounds{box.left, box.top, box.getRight(), box.getBottom()};
+    }
+
+    constexpr Vector2<Float> getLower() const noexcept
+    {
+        return Vector2<Float>(left, top);
+    }
+
+    constexpr Vector2<Float> getUpper() const noexcept
+    {
+        return Vector2<Float>(right, bottom);
+    }
+
+    constexpr bool intersects(const Bounds& bounds) const noexcept
+    {
+        return !(left >= bounds.right || right <= bounds.left ||
+            top >= bounds.bottom || bottom <= bounds.top);
+    }
+
+    // Euclidean distance from point to the bounds, zero if point is inside
+    Float getDistance(const Vector2<Float>& point) const
+    {
+        return std::sqrt(getSquaredDistance(point));
+    }
+
+    // Same as above but squared, it is exact for integer coordinates
+    constexpr Float getSquaredDistance(const Vector2<Float>& point) const noexcept
+    {
+        auto dx = std::max({left - point.x, Float(0), point.x - right});
+        auto dy = std::max({top - point.y, Float(0), point.y - bottom});
+        return dx * dx + dy * dy;
+    }
+
+    // Return true if the ray origin + t * direction hits the bounds for a t in
+    // [0, maxT], in that case t is set to the smallest one, bounds are
+    // considered closed so that a ray grazing a side hits them
+    bool intersects(const Vector2<Float>& origin, const Vector2<Float>& direction, Float maxT, Float& t) const
+    {
+        auto tMin = Float(0);
+        auto tMax = maxT;
+        if (!clip(origin.x, direction.x, left, right, tMin, tMax) ||
+            !clip(origin.y, direction.y, top, bottom, tMin, tMax))
+            return false;
+        t = tMin;
+        return true;
+    }
+
+private:
+    // Slab test on one axis
+    static bool clip(Float origin, Float direction, Float min, Float max, Float& tMin, Float& tMax)
+    {
+        if (direction == 0)
+            return min <= origin && origin <= max;
+        auto t1 = (min - origin) / direction;
+        auto t2 = (max - origin) / direction;
+        if (t1 > t2)
+            std::swap(t1, t2);
+        tMin = std::max(tMin, t1);
+        tMax = std::min(tMax, t2);
+        return tMin <= tMax;
+    }
+};
+
+// Bounds stored in structure-of-arrays layout
+template<typename Float>
+struct BoundsArrays
+{
+    const Float* lefts;
+    const Float* tops;
+    const Float* rights;
+    const Float* bottoms;
+
+    constexpr Bounds<Float> operator[](std::size_t i) const noexcept
+    {
+        return Bounds<Float>{lefts[i], tops[i], rights[i], bottoms[i]};
+    }
+};
+
+}
@@ -1,13 +1,64 @@
 #pragma once
 
+#include <cstddef>
 #include "Vector2.h"
 
 namespace quadtree
 {
 
-template<typename T>
+// Axis-aligned box in dimension D, the boxes of dimension 2 and 3 name their
+// sides, all of them are accessed by their position and their size
+template<typename T, std::size_t D = 2>
 class Box
 {
+public:
+    Vector<T, D> position;
+    Vector<T, D> size; // Must be positive
+
+    constexpr Box() noexcept = default;
+
+    constexpr Box(const Vector<T, D>& Position, const Vector<T, D>& Size) noexcept :
+        position(Position), size(Size)
+    {
+
+    }
+
+    constexpr Vector<T, D> getPosition() const noexcept
+    {
+        return position;
+    }
+
+    constexpr Vector<T, D> getSize() const noexcept
+    {
+        return size;
+    }
+
+    constexpr bool contains(const Box& box) const noexcept
+    {
+        for (auto axis = std::size_t(0); axis < D; ++axis)
+        {
+            if (box.position[axis] < position[axis] ||
+                position[axis] + size[axis] < box.position[axis] + box.size[axis])
+                return false;
+        }
+        return true;
+    }
+
+    constexpr bool intersects(const Box& box) const noexcept
+    {
+        for (auto axis = std::size_t(0); axis < D; ++axis)
+        {
+            if (position[axis] >= box.position[axis] + box.size[axis] ||
+                position[axis] + size[axis] <= box.position[axis])
+                return false;
+        }
+        return true;
+    }
+};
+
+template<typename T>
+class Box<T, 2>
+{
 public:
     T left;
     T top;
@@ -41,6 +92,11 @@ public:
         return Vector2<T>(left, top);
     }
 
+    constexpr Vector2<T> getPosition() const noexcept
+    {
+        return getTopLeft();
+    }
+
     constexpr Vector2<T> getCenter() const noexcept
     {
         return Vector2<T>(left + width / 2, top + height / 2);
@@ -64,4 +120,82 @@ public:
     }
 };
 
-}
\ No newline at end of file
+// The third axis goes from front to back
+template<typename T>
+class Box<T, 3>
+{
+public:
+    T left;
+    T top;
+    T front;
+    T width; // Must be positive
+    T height; // Must be positive
+    T depth; // Must be positive
+
+    constexpr Box(T Left = 0, T Top = 0, T Front = 0, T Width = 0, T Height = 0, T Depth = 0) noexcept :
+        left(Left), top(Top), front(Front), width(Width), height(Height), depth(Depth)
+    {
+
+    }
+
+    constexpr Box(const Vector3<T>& position, const Vector3<T>& size) noexcept :
+        left(position.x), top(position.y), front(position.z), width(size.x), height(size.y), depth(size.z)
+    {
+
+    }
+
+    constexpr T getRight() const noexcept
+    {
+        return left + width;
+    }
+
+    constexpr T getBottom() const noexcept
+    {
+        return top + height;
+    }
+
+    constexpr T getBack() const noexcept
+    {
+        return front + depth;
+    }
+
+    constexpr Vector3<T> getPosition() const noexcept
+    {
+        return Vector3<T>(left, top, front);
+    }
+
+    constexpr Vector3<T> getCenter() const noexcept
+    {
+        return Vector3<T>(left + width / 2, top + height / 2, front + depth / 2);
+    }
+
+    constexpr Vector3<T> getSize() const noexcept
+    {
+        return Vector3<T>(width, height, depth);
+    }
+
+    constexpr bool contains(const Box& box) const noexcept
+    {
+        return left <= box.left && box.getRight() <= getRight() &&
+            top <= box.top && box.getBottom() <= getBottom() &&
+            front <= box.front && box.getBack() <= getBack();
+    }
+
+    constexpr bool intersects(const Box& box) const noexcept
+    {
+        return !(left >= box.getRight() || getRight() <= box.left ||
+            top >= box.getBottom() || getBottom() <= box.top ||
+            front >= box.getBack() || getBack() <= box.front);
+    }
+};
+
+template<typename T>
+Box(T, T, T, T) -> Box<T, 2>;
+
+template<typename T>
+Box(T, T, T, T, T, T) -> Box<T, 3>;
+
+template<typename T, std::size_t D>
+Box(const Vector<T, D>&, const Vector<T, D>&) -> Box<T, D>;
+
+}
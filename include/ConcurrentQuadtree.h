@@ -0,0 +1,404 @@
+#pragma once
+
+#include <cassert>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Box.h"
+#include "Epoch.h"
+#include "Parameters.h"
+#include "Quadrant.h"
+#include "Simd.h"
+#include "ValueStorage.h"
+
+namespace quadtree
+{
+
+// Quadtree that can be read by many threads while one thread modifies it
+// Published nodes are never modified: the writer copies the nodes on the path
+// of a change and publishes the new root, the nodes it replaced are only
+// deleted once no reader can still walk them
+// The readers never take a lock, add and remove must not be called concurrently
+template<typename T, typename GetBox, typename Equal = std::equal_to<T>, typename Float = float,
+    typename Parameters = StaticParameters<>>
+class ConcurrentQuadtree
+{
+    static_assert(std::is_convertible_v<std::invoke_result_t<GetBox, const T&>, Box<Float>>,
+        "GetBox must be a callable of signature Box<Float>(const T&)");
+    static_assert(std::is_convertible_v<std::invoke_result_t<Equal, const T&, const T&>, bool>,
+        "Equal must be a callable of signature bool(const T&, const T&)");
+    static_assert(std::is_arithmetic_v<Float>);
+
+public:
+    ConcurrentQuadtree(const Box<Float>& box, const GetBox& getBox = GetBox(), const Equal& equal = Equal(),
+        const Parameters& parameters = Parameters()) :
+        mBox(box), mRoot(new Node{{}, new Values()}), mGetBox(getBox), mEqual(equal), mParameters(parameters)
+    {
+
+    }
+
+    ConcurrentQuadtree(const ConcurrentQuadtree&) = delete;
+    ConcurrentQuadtree& operator=(const ConcurrentQuadtree&) = delete;
+
+    // No reader must remain
+    ~ConcurrentQuadtree()
+    {
+        destroy(mRoot.load());
+    }
+
+    // Writer only
+    void add(const T& value)
+    {
+        assert(mBox.contains(mGetBox(value)));
+        publish(add(mRoot.load(std::memory_order_relaxed), 0, mBox, value, Bounds<Float>::fromBox(mGetBox(value))));
+    }
+
+    // Writer only
+    void remove(const T& value)
+    {
+        assert(mBox.contains(mGetBox(value)));
+        publish(remove(mRoot.load(std::memory_order_relaxed), mBox, value, Bounds<Float>::fromBox(mGetBox(value))));
+    }
+
+    std::vector<T> query(const Box<Float>& box) const
+    {
+        auto values = std::vector<T>();
+        query(box, std::back_inserter(values));
+        return values;
+    }
+
+    // Call visitor(value) for each value intersecting box, if visitor returns
+    // a bool, the query stops as soon as it returns false
+    // The query sees the tree as it was when it started
+    // Return false if the query has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&>, bool> query(const Box<Float>& box, Visitor&& visitor) const
+    {
+        auto guard = mEpochs.pin();
+        return query(mRoot.load(), mBox, Bounds<Float>::fromBox(box), visitor);
+    }
+
+    // Write the values intersecting box in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&>, OutputIt> query(const Box<Float>& box, OutputIt out) const
+    {
+        query(box, [&out](const T& value){ *out++ = value; });
+        return out;
+    }
+
+    std::vector<std::pair<T, T>> findAllIntersections() const
+    {
+        auto intersections = std::vector<std::pair<T, T>>();
+        findAllIntersections(std::back_inserter(intersections));
+        return intersections;
+    }
+
+    // Call visitor(value1, value2) for each pair of intersecting values, if
+    // visitor returns a bool, the search stops as soon as it returns false
+    // The search sees the tree as it was when it started
+    // Return false if the search has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&, const T&>, bool> findAllIntersections(Visitor&& visitor) const
+    {
+        auto guard = mEpochs.pin();
+        return findAllIntersections(mRoot.load(), visitor);
+    }
+
+    // Write the pairs of intersecting values in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&, const T&>, OutputIt> findAllIntersections(OutputIt out) const
+    {
+        findAllIntersections([&out](const T& value1, const T& value2){ *out++ = std::pair<T, T>(value1, value2); });
+        return out;
+    }
+
+    Box<Float> getBox() const
+    {
+        return mBox;
+    }
+
+    // Writer only, number of replaced nodes and value vectors not deleted yet
+    std::size_t getNbRetired() const
+    {
+        return mEpochs.getNbRetired();
+    }
+
+private:
+    using Values = CachedValueVector<T, Float>;
+
+    // Only modified by the writer before being published
+    struct Node
+    {
+        std::array<Node*, 4> children; // All null for leaves
+        Values* values;
+    };
+
+    Box<Float> mBox;
+    std::atomic<Node*> mRoot;
+    mutable EpochManager mEpochs;
+    GetBox mGetBox;
+    Equal mEqual;
+    Parameters mParameters;
+
+    // Call visitor with args and return false if the traversal must stop
+    template<typename Visitor, typename... Args>
+    static bool visit(Visitor& visitor, const Args&... args)
+    {
+        if constexpr (std::is_same_v<std::invoke_result_t<Visitor&, const Args&...>, bool>)
+            return visitor(args...);
+        else
+        {
+            visitor(args...);
+            return true;
+        }
+    }
+
+    static bool isLeaf(const Node* node)
+    {
+        return node->children[0] == nullptr;
+    }
+
+    static void deleteNode(void* node)
+    {
+        delete static_cast<Node*>(node);
+    }
+
+    static void deleteValues(void* values)
+    {
+        delete static_cast<Values*>(values);
+    }
+
+    static void destroy(Node* node)
+    {
+        if (!isLeaf(node))
+        {
+            for (auto child : node->children)
+                destroy(child);
+        }
+        delete node->values;
+        delete node;
+    }
+
+    // Nodes and values retired before the root is published can still be
+    // reached by the readers that pinned the current epoch
+    void retire(Node* node, bool withValues)
+    {
+        if (withValues)
+            mEpochs.retire(node->values, &deleteValues);
+        mEpochs.retire(node, &deleteNode);
+    }
+
+    void publish(Node* root)
+    {
+        mRoot.store(root);
+        mEpochs.advance();
+    }
+
+    // Return a copy of node to which value is added
+    Node* add(Node* node, std::size_t depth, const Box<Float>& box, const T& value, const Bounds<Float>& valueBounds)
+    {
+        assert(node != nullptr);
+        if (isLeaf(node))
+        {
+            // Insert the value in this node if possible
+            if (depth >= mParameters.getMaxDepth() || node->values->size() < mParameters.getThreshold())
+            {
+                auto values = new Values(*node->values);
+                values->push_back(value, valueBounds);
+                retire(node, true);
+                return new Node{{}, values};
+            }
+            // Otherwise, we split and we try again
+            else
+                return add(split(node, box), depth, box, value, valueBounds);
+        }
+        else
+        {
+            auto i = getQuadrant(box, valueBounds);
+            // Add the value in a child if it fits in it
+            if (i != -1)
+            {
+                auto newNode = new Node{node->children, node->values};
+                newNode->children[static_cast<std::size_t>(i)] = add(node->children[static_cast<std::size_t>(i)],
+                    depth + 1, computeBox(box, i), value, valueBounds);
+                retire(node, false);
+                return newNode;
+            }
+            // Otherwise, we add the value in the current node
+            else
+            {
+                auto values = new Values(*node->values);
+                values->push_back(value, valueBounds);
+                retire(node, true);
+                return new Node{node->children, values};
+            }
+        }
+    }
+
+    // Return a copy of node whose values are moved to new children
+    Node* split(Node* node, const Box<Float>& box)
+    {
+        assert(node != nullptr);
+        assert(isLeaf(node) && "Only leaves can be split");
+        auto newNode = new Node{{}, new Values()};
+        for (auto& child : newNode->children)
+            child = new Node{{}, new Values()};
+        // Assign values to children
+        for (auto j = std::size_t(0); j < node->values->size(); ++j)
+        {
+            auto valueBounds = node->values->getBounds(j, mGetBox);
+            auto i = getQuadrant(box, valueBounds);
+            if (i != -1)
+                newNode->children[static_cast<std::size_t>(i)]->values->push_back((*node->values)[j], valueBounds);
+            else
+                newNode->values->push_back((*node->values)[j], valueBounds);
+        }
+        retire(node, true);
+        return newNode;
+    }
+
+    // Return a copy of node from which value is removed
+    Node* remove(Node* node, const Box<Float>& box, const T& value, const Bounds<Float>& valueBounds)
+    {
+        assert(node != nullptr);
+        if (!isLeaf(node))
+        {
+            // Remove the value in a child if it fits in it
+            auto i = getQuadrant(box, valueBounds);
+            if (i != -1)
+            {
+                auto newNode = new Node{node->children, node->values};
+                newNode->children[static_cast<std::size_t>(i)] = remove(node->children[static_cast<std::size_t>(i)],
+                    computeBox(box, i), value, valueBounds);
+                retire(node, false);
+                return tryMerge(newNode);
+            }
+        }
+        // Otherwise, we remove the value from the current node
+        auto values = new Values(*node->values);
+        removeValue(*values, value);
+        retire(node, true);
+        return new Node{node->children, values};
+    }
+
+    void removeValue(Values& values, const T& value) const
+    {
+        // Find the value in values
+        auto i = std::size_t(0);
+        while (i < values.size() && !mEqual(value, values[i]))
+            ++i;
+        assert(i < values.size() && "Trying to remove a value that is not present in the node");
+        // Swap with the last element and pop back
+        values.erase(i);
+    }
+
+    // Return a leaf containing the values of node and of its children if
+    // they fit in it, node otherwise
+    Node* tryMerge(Node* node)
+    {
+        assert(node != nullptr);
+        assert(!isLeaf(node) && "Only interior nodes can be merged");
+        auto nbValues = node->values->size();
+        for (auto child : node->children)
+        {
+            if (!isLeaf(child))
+                return node;
+            nbValues += child->values->size();
+        }
+        if (nbValues <= mParameters.getThreshold())
+        {
+            auto values = new Values(*node->values);
+            values->reserve(nbValues);
+            // Merge the values of all the children
+            for (auto child : node->children)
+            {
+                values->append(*child->values);
+                retire(child, true);
+            }
+            retire(node, true);
+            return new Node{{}, values};
+        }
+        else
+            return node;
+    }
+
+    template<typename Visitor>
+    bool query(const Node* node, const Box<Float>& box, const Bounds<Float>& queryBounds, Visitor& visitor) const
+    {
+        assert(node != nullptr);
+        const auto& values = *node->values;
+        if (!forEachIntersectingBounds(queryBounds, values.getBoundsArrays(), 0, values.size(),
+            [&visitor, &values](std::size_t i){ return visit(visitor, values[i]); }))
+            return false;
+        if (!isLeaf(node))
+        {
+            for (auto i = std::size_t(0); i < 4; ++i)
+            {
+                auto childBox = computeBox(box, static_cast<int>(i));
+                if (queryBounds.intersects(Bounds<Float>::fromBox(childBox)) &&
+                    !query(node->children[i], childBox, queryBounds, visitor))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    template<typename Visitor>
+    bool findAllIntersections(const Node* node, Visitor& visitor) const
+    {
+        // Find intersections between values stored in this node
+        // Make sure to not report the same intersection twice
+        const auto& values = *node->values;
+        for (auto i = std::size_t(0); i < values.size(); ++i)
+        {
+            if (!forEachIntersectingBounds(values.getBounds(i, mGetBox), values.getBoundsArrays(), 0, i,
+                [&visitor, &values, i](std::size_t j){ return visit(visitor, values[i], values[j]); }))
+                return false;
+        }
+        if (!isLeaf(node))
+        {
+            // Values in this node can intersect values in descendants
+            for (auto i = std::size_t(0); i < values.size(); ++i)
+            {
+                for (auto child : node->children)
+                {
+                    if (!findIntersectionsInDescendants(child, values[i], values.getBounds(i, mGetBox), visitor))
+                        return false;
+                }
+            }
+            // Find intersections in children
+            for (auto child : node->children)
+            {
+                if (!findAllIntersections(child, visitor))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    template<typename Visitor>
+    bool findIntersectionsInDescendants(const Node* node, const T& value, const Bounds<Float>& valueBounds,
+        Visitor& visitor) const
+    {
+        // Test against the values stored in this node
+        const auto& values = *node->values;
+        if (!forEachIntersectingBounds(valueBounds, values.getBoundsArrays(), 0, values.size(),
+            [&visitor, &value, &values](std::size_t i){ return visit(visitor, value, values[i]); }))
+            return false;
+        // Test against values stored into descendants of this node
+        if (!isLeaf(node))
+        {
+            for (auto child : node->children)
+            {
+                if (!findIntersectionsInDescendants(child, value, valueBounds, visitor))
+                    return false;
+            }
+        }
+        return true;
+    }
+};
+
+}
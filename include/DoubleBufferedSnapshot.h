@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include "Snapshot.h"
+
+namespace quadtree
+{
+
+// Read-only snapshot of a tree published once per tick by the thread that
+// modifies the tree, while other threads query the last published snapshot
+// The snapshots are built in two sets of buffers used alternately, so that
+// once both have grown to the size of the tree, publishing does not allocate
+template<typename T, typename Float = float>
+class DoubleBufferedSnapshot
+{
+    using Buffers = SnapshotBuffers<T, Float>;
+
+public:
+    // Snapshot acquired by a reader, the buffers it reads are not rebuilt
+    // until it is destroyed
+    class View
+    {
+    public:
+        View(const Buffers& buffers, std::atomic<std::size_t>* nbReaders) :
+            mQuadtree(buffers), mNbReaders(nbReaders)
+        {
+
+        }
+
+        View(const View&) = delete;
+        View& operator=(const View&) = delete;
+
+        View(View&& other) noexcept :
+            mQuadtree(other.mQuadtree), mNbReaders(std::exchange(other.mNbReaders, nullptr))
+        {
+
+        }
+
+        View& operator=(View&& other) noexcept
+        {
+            std::swap(mQuadtree, other.mQuadtree);
+            std::swap(mNbReaders, other.mNbReaders);
+            return *this;
+        }
+
+        ~View()
+        {
+            if (mNbReaders != nullptr)
+                mNbReaders->fetch_sub(1, std::memory_order_release);
+        }
+
+        const SnapshotQuadtree<T, Float>& operator*() const
+        {
+            return mQuadtree;
+        }
+
+        const SnapshotQuadtree<T, Float>* operator->() const
+        {
+            return &mQuadtree;
+        }
+
+    private:
+        SnapshotQuadtree<T, Float> mQuadtree;
+        std::atomic<std::size_t>* mNbReaders;
+    };
+
+    // The snapshot is empty until the first publication
+    explicit DoubleBufferedSnapshot(const Box<Float>& box)
+    {
+        for (auto& buffers : mBuffers)
+        {
+            buffers.box = box;
+            buffers.nodes.emplace_back();
+        }
+    }
+
+    DoubleBufferedSnapshot(const DoubleBufferedSnapshot&) = delete;
+    DoubleBufferedSnapshot& operator=(const DoubleBufferedSnapshot&) = delete;
+
+    // Writer only, rebuild the buffers that are not published from quadtree
+    // and publish them, wait for the readers still using them
+    template<typename Quadtree>
+    void publish(const Quadtree& quadtree)
+    {
+        auto back = 1 - mFront.load(std::memory_order_relaxed);
+        while (mNbReaders[back].load() != 0)
+            std::this_thread::yield();
+        quadtree.buildSnapshot(mBuffers[back]);
+        mFront.store(back);
+    }
+
+    // Acquire the last published snapshot, it stays valid while the view is
+    // alive, views should not be kept longer than a tick as they prevent the
+    // next publication
+    View acquire() const
+    {
+        while (true)
+        {
+            auto front = mFront.load();
+            mNbReaders[front].fetch_add(1);
+            // The buffers may have been swapped before the reader was counted
+            if (mFront.load() == front)
+                return View(mBuffers[front], &mNbReaders[front]);
+            mNbReaders[front].fetch_sub(1);
+        }
+    }
+
+    // Writer only, current capacity of the buffers of both snapshots
+    std::size_t getMemoryUsage() const
+    {
+        auto memoryUsage = std::size_t(0);
+        for (const auto& buffers : mBuffers)
+        {
+            memoryUsage += buffers.nodes.capacity() * sizeof(SnapshotNode) + buffers.values.capacity() * sizeof(T) +
+                (buffers.lefts.capacity() + buffers.tops.capacity() + buffers.rights.capacity() +
+                buffers.bottoms.capacity()) * sizeof(Float);
+        }
+        return memoryUsage;
+    }
+
+private:
+    std::array<Buffers, 2> mBuffers;
+    std::atomic<std::size_t> mFront = 0;
+    mutable std::array<std::atomic<std::size_t>, 2> mNbReaders = {};
+};
+
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <utility>
+
+namespace quadtree
+{
+
+// Epoch-based reclamation for one writer and many readers: readers pin the
+// current epoch while they access shared objects and the writer retires the
+// objects it unlinks, a retired object is only deleted once no reader pinned
+// an epoch in which it was reachable
+class EpochManager
+{
+    struct alignas(64) Slot
+    {
+        std::atomic<std::uint64_t> epoch = 0; // Zero if the slot is free
+    };
+
+public:
+    static constexpr auto NbSlots = std::size_t(64); // Maximum number of concurrent readers
+
+    // Unpin the epoch when destroyed
+    class Guard
+    {
+    public:
+        explicit Guard(Slot* slot) noexcept : mSlot(slot)
+        {
+
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        Guard(Guard&& other) noexcept : mSlot(std::exchange(other.mSlot, nullptr))
+        {
+
+        }
+
+        Guard& operator=(Guard&& other) noexcept
+        {
+            std::swap(mSlot, other.mSlot);
+            return *this;
+        }
+
+        ~Guard()
+        {
+            if (mSlot != nullptr)
+                mSlot->epoch.store(0, std::memory_order_release);
+        }
+
+    private:
+        Slot* mSlot;
+    };
+
+    EpochManager() = default;
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    // No reader must remain
+    ~EpochManager()
+    {
+        for (auto& retired : mRetired)
+            retired.deleter(retired.pointer);
+    }
+
+    // Pin the current epoch, shared objects must be loaded after this call
+    Guard pin()
+    {
+        auto epoch = mEpoch.load();
+        // Start from a slot depending on the thread to limit contention
+        auto first = std::hash<std::thread::id>()(std::this_thread::get_id());
+        while (true)
+        {
+            for (auto i = std::size_t(0); i < NbSlots; ++i)
+            {
+                auto& slot = mSlots[(first + i) % NbSlots];
+                auto expected = std::uint64_t(0);
+                if (slot.epoch.load(std::memory_order_relaxed) == 0 && slot.epoch.compare_exchange_strong(expected, epoch))
+                    return Guard(&slot);
+            }
+            // All the slots are taken
+            std::this_thread::yield();
+        }
+    }
+
+    // Writer only, delete pointer with deleter once it is not reachable by
+    // readers anymore, pointer must already be unlinked from the shared objects
+    void retire(void* pointer, void (*deleter)(void*))
+    {
+        mRetired.push_back(Retired{mEpoch.load(std::memory_order_relaxed), pointer, deleter});
+    }
+
+    // Writer only, start a new epoch and delete the objects that are not
+    // reachable anymore
+    void advance()
+    {
+        mEpoch.fetch_add(1);
+        auto minEpoch = std::numeric_limits<std::uint64_t>::max();
+        for (const auto& slot : mSlots)
+        {
+            auto epoch = slot.epoch.load();
+            if (epoch != 0)
+                minEpoch = std::min(minEpoch, epoch);
+        }
+        // Readers that pinned a later epoch can not reach the objects
+        while (!mRetired.empty() && mRetired.front().epoch < minEpoch)
+        {
+            mRetired.front().deleter(mRetired.front().pointer);
+            mRetired.pop_front();
+        }
+    }
+
+    std::size_t getNbRetired() const
+    {
+        return mRetired.size();
+    }
+
+private:
+    struct Retired
+    {
+        std::uint64_t epoch;
+        void* pointer;
+        void (*deleter)(void*);
+    };
+
+    std::array<Slot, NbSlots> mSlots;
+    std::atomic<std::uint64_t> mEpoch = 1;
+    std::deque<Retired> mRetired;
+};
+
+}
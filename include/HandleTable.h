@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace quadtree
+{
+
+// Stable reference to a value of a tree, it is invalidated when the value is
+// removed and a slot is never reused with the same generation
+struct Handle
+{
+    std::uint32_t index;
+    std::uint32_t generation;
+
+    bool operator==(const Handle& other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const Handle& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// Location of the value of each handle, the tree updates it each time a value
+// moves in or between nodes
+template<typename Node, typename Allocator = std::allocator<Node>>
+class HandleTable
+{
+public:
+    struct Location
+    {
+        Node* node;
+        std::uint32_t position;
+        std::uint32_t generation;
+    };
+
+    explicit HandleTable(const Allocator& allocator = Allocator()) : mLocations(allocator)
+    {
+
+    }
+
+    Handle create()
+    {
+        // Reuse a free slot if possible
+        if (mFreeList != Null)
+        {
+            auto index = mFreeList;
+            mFreeList = mLocations[index].position;
+            return Handle{index, mLocations[index].generation};
+        }
+        assert(mLocations.size() < Null && "Too many handles");
+        mLocations.push_back(Location{nullptr, 0, 0});
+        return Handle{static_cast<std::uint32_t>(mLocations.size() - 1), 0};
+    }
+
+    void destroy(Handle handle)
+    {
+        assert(isValid(handle) && "Invalid handle");
+        destroy(handle.index);
+    }
+
+    void destroy(std::uint32_t index)
+    {
+        auto& location = mLocations[index];
+        ++location.generation;
+        location.node = nullptr;
+        location.position = mFreeList;
+        mFreeList = index;
+    }
+
+    bool isValid(Handle handle) const
+    {
+        return handle.index < mLocations.size() && mLocations[handle.index].generation == handle.generation;
+    }
+
+    const Location& get(Handle handle) const
+    {
+        assert(isValid(handle) && "Invalid handle");
+        return mLocations[handle.index];
+    }
+
+    void set(std::uint32_t index, Node* node, std::size_t position)
+    {
+        mLocations[index].node = node;
+        mLocations[index].position = static_cast<std::uint32_t>(position);
+    }
+
+    // Heap memory in bytes
+    std::size_t getMemoryUsage() const
+    {
+        return mLocations.capacity() * sizeof(Location);
+    }
+
+private:
+    static constexpr auto Null = std::numeric_limits<std::uint32_t>::max();
+
+    // The position of a free slot is the index of the next free slot
+    std::vector<Location, typename std::allocator_traits<Allocator>::template rebind_alloc<Location>> mLocations;
+    std::uint32_t mFreeList = Null;
+};
+
+}
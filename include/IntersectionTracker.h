@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cassert>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace quadtree
+{
+
+// Set of intersecting pairs of values maintained from one frame to the next,
+// only the values that have moved since the last update are tested against the
+// tree so that the cost is proportional to the number of changed pairs
+template<typename T, typename Hash = std::hash<T>, typename Equal = std::equal_to<T>>
+class IntersectionTracker
+{
+public:
+    IntersectionTracker(const Hash& hash = Hash(), const Equal& equal = Equal()) :
+        mNeighbors(0, hash, equal), mEqual(equal)
+    {
+
+    }
+
+    // Test the values in [first, last) against the tree, that must contain
+    // them, and write the pairs that start and stop intersecting in
+    // addedPairs and removedPairs, the first value of a pair is the updated one
+    // New values are added to the tracker and values can appear several times
+    template<typename Quadtree, typename InputIt, typename AddedIt, typename RemovedIt>
+    void update(const Quadtree& quadtree, InputIt first, InputIt last, AddedIt addedPairs, RemovedIt removedPairs)
+    {
+        for (; first != last; ++first)
+        {
+            const auto& value = *first;
+            mIntersections.clear();
+            quadtree.findIntersections(value, std::back_inserter(mIntersections));
+            auto& neighbors = mNeighbors[value];
+            // The pairs between two updated values are already up to date when
+            // the second one is processed so they are not reported twice
+            for (const auto& neighbor : neighbors)
+            {
+                if (!contains(mIntersections, neighbor))
+                {
+                    *removedPairs++ = std::pair<T, T>(value, neighbor);
+                    erase(mNeighbors[neighbor], value);
+                }
+            }
+            for (const auto& intersection : mIntersections)
+            {
+                if (!contains(neighbors, intersection))
+                {
+                    *addedPairs++ = std::pair<T, T>(value, intersection);
+                    mNeighbors[intersection].push_back(value);
+                }
+            }
+            neighbors.swap(mIntersections);
+        }
+    }
+
+    // Forget value, that must be done when it is removed from the tree, and
+    // write the pairs it was part of in removedPairs
+    template<typename RemovedIt>
+    void remove(const T& value, RemovedIt removedPairs)
+    {
+        auto it = mNeighbors.find(value);
+        if (it == std::end(mNeighbors))
+            return;
+        for (const auto& neighbor : it->second)
+        {
+            *removedPairs++ = std::pair<T, T>(value, neighbor);
+            erase(mNeighbors[neighbor], value);
+        }
+        mNeighbors.erase(it);
+    }
+
+    void clear()
+    {
+        mNeighbors.clear();
+    }
+
+    // Number of intersecting pairs
+    std::size_t size() const
+    {
+        auto n = std::size_t(0);
+        for (const auto& [value, neighbors] : mNeighbors)
+            n += neighbors.size();
+        return n / 2;
+    }
+
+    // Call f(value1, value2) once for each intersecting pair
+    template<typename F>
+    void forEachPair(F&& f) const
+    {
+        for (const auto& [value, neighbors] : mNeighbors)
+        {
+            for (const auto& neighbor : neighbors)
+            {
+                // Each pair is stored in the neighbors of its two values
+                if (&mNeighbors.find(neighbor)->first < &value)
+                    f(value, neighbor);
+            }
+        }
+    }
+
+private:
+    // A value intersects a few others only so neighbors are kept in vectors
+    // and searched linearly
+    std::unordered_map<T, std::vector<T>, Hash, Equal> mNeighbors;
+    Equal mEqual;
+    std::vector<T> mIntersections;
+
+    bool contains(const std::vector<T>& values, const T& value) const
+    {
+        return std::any_of(std::begin(values), std::end(values),
+            [this, &value](const T& other){ return mEqual(value, other); });
+    }
+
+    void erase(std::vector<T>& values, const T& value) const
+    {
+        auto it = std::find_if(std::begin(values), std::end(values),
+            [this, &value](const T& other){ return mEqual(value, other); });
+        assert(it != std::end(values));
+        *it = std::move(values.back());
+        values.pop_back();
+    }
+};
+
+}
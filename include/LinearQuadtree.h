@@ -0,0 +1,280 @@
+#pragma once
+
+#include <cassert>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Box.h"
+#include "Quadrant.h"
+#include "Simd.h"
+
+namespace quadtree
+{
+
+// Quadtree without nodes: each value is associated to the smallest cell of
+// depth at most MaxDepth containing it and the values are sorted by the
+// Z-order of their cells so that the values of a subtree are contiguous,
+// it is meant for static or mostly static data as add and remove are linear
+// in the number of values
+template<typename T, typename GetBox, typename Equal = std::equal_to<T>, typename Float = float>
+class LinearQuadtree
+{
+    static_assert(std::is_convertible_v<std::invoke_result_t<GetBox, const T&>, Box<Float>>,
+        "GetBox must be a callable of signature Box<Float>(const T&)");
+    static_assert(std::is_convertible_v<std::invoke_result_t<Equal, const T&, const T&>, bool>,
+        "Equal must be a callable of signature bool(const T&, const T&)");
+    static_assert(std::is_arithmetic_v<Float>);
+
+public:
+    LinearQuadtree(const Box<Float>& box, const GetBox& getBox = GetBox(),
+        const Equal& equal = Equal()) :
+        mBox(box), mGetBox(getBox), mEqual(equal)
+    {
+
+    }
+
+    // Build the tree from the values in [first, last), the values are sorted once
+    template<typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+    LinearQuadtree(const Box<Float>& box, InputIt first, InputIt last, const GetBox& getBox = GetBox(),
+        const Equal& equal = Equal()) :
+        LinearQuadtree(box, getBox, equal)
+    {
+        auto entries = std::vector<std::pair<std::uint64_t, std::size_t>>();
+        auto values = std::vector<T>(first, last);
+        auto bounds = std::vector<Bounds<Float>>();
+        bounds.reserve(values.size());
+        for (auto i = std::size_t(0); i < values.size(); ++i)
+        {
+            assert(mBox.contains(mGetBox(values[i])));
+            bounds.push_back(Bounds<Float>::fromBox(mGetBox(values[i])));
+            entries.emplace_back(computeKey(bounds.back()), i);
+        }
+        std::sort(std::begin(entries), std::end(entries));
+        reserve(entries.size());
+        for (const auto& [key, i] : entries)
+            insert(mKeys.size(), key, values[i], bounds[i]);
+    }
+
+    void add(const T& value)
+    {
+        assert(mBox.contains(mGetBox(value)));
+        auto bounds = Bounds<Float>::fromBox(mGetBox(value));
+        auto key = computeKey(bounds);
+        // Insert after the values of the same cell
+        auto i = std::upper_bound(std::begin(mKeys), std::end(mKeys), key) - std::begin(mKeys);
+        insert(static_cast<std::size_t>(i), key, value, bounds);
+    }
+
+    void remove(const T& value)
+    {
+        assert(mBox.contains(mGetBox(value)));
+        auto key = computeKey(Bounds<Float>::fromBox(mGetBox(value)));
+        // Find the value among the values of its cell
+        auto i = static_cast<std::size_t>(std::lower_bound(std::begin(mKeys), std::end(mKeys), key) - std::begin(mKeys));
+        while (i < mKeys.size() && mKeys[i] == key && !mEqual(value, mValues[i]))
+            ++i;
+        assert(i < mKeys.size() && mKeys[i] == key && "Trying to remove a value that is not present in the tree");
+        erase(i);
+    }
+
+    std::vector<T> query(const Box<Float>& box) const
+    {
+        auto values = std::vector<T>();
+        query(box, std::back_inserter(values));
+        return values;
+    }
+
+    // Call visitor(value) for each value intersecting box, if visitor returns
+    // a bool, the query stops as soon as it returns false
+    // Return false if the query has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&>, bool> query(const Box<Float>& box, Visitor&& visitor) const
+    {
+        return query(0, 0, mBox, 0, mKeys.size(), Bounds<Float>::fromBox(box), visitor);
+    }
+
+    // Write the values intersecting box in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&>, OutputIt> query(const Box<Float>& box, OutputIt out) const
+    {
+        query(box, [&out](const T& value){ *out++ = value; });
+        return out;
+    }
+
+    std::vector<std::pair<T, T>> findAllIntersections() const
+    {
+        auto intersections = std::vector<std::pair<T, T>>();
+        findAllIntersections(std::back_inserter(intersections));
+        return intersections;
+    }
+
+    // Call visitor(value1, value2) for each pair of intersecting values, if
+    // visitor returns a bool, the search stops as soon as it returns false
+    // Return false if the search has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&, const T&>, bool> findAllIntersections(Visitor&& visitor) const
+    {
+        auto boxes = getBoundsArrays();
+        for (auto i = std::size_t(0); i < mKeys.size(); ++i)
+        {
+            // A value can only intersect the values stored after it in the range of its cell
+            auto last = static_cast<std::size_t>(std::lower_bound(std::begin(mKeys) + static_cast<std::ptrdiff_t>(i),
+                std::end(mKeys), getCellEnd(mKeys[i])) - std::begin(mKeys));
+            if (!forEachIntersectingBounds(boxes[i], boxes, i + 1, last,
+                [this, &visitor, i](std::size_t j){ return visit(visitor, mValues[i], mValues[j]); }))
+                return false;
+        }
+        return true;
+    }
+
+    // Write the pairs of intersecting values in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&, const T&>, OutputIt> findAllIntersections(OutputIt out) const
+    {
+        findAllIntersections([&out](const T& value1, const T& value2){ *out++ = std::pair<T, T>(value1, value2); });
+        return out;
+    }
+
+    Box<Float> getBox() const
+    {
+        return mBox;
+    }
+
+private:
+    static constexpr auto MaxDepth = std::size_t(8);
+    static constexpr auto DepthBits = std::size_t(6);
+    static constexpr auto ScanThreshold = std::size_t(32); // Smaller ranges are scanned without descending further
+
+    Box<Float> mBox;
+    GetBox mGetBox;
+    Equal mEqual;
+    // The key of a value is the Morton code of its cell extended to MaxDepth
+    // followed by the depth of the cell, values are sorted by key
+    std::vector<std::uint64_t> mKeys;
+    std::vector<T> mValues;
+    std::vector<Float> mLefts;
+    std::vector<Float> mTops;
+    std::vector<Float> mRights;
+    std::vector<Float> mBottoms;
+
+    // Call visitor with args and return false if the traversal must stop
+    template<typename Visitor, typename... Args>
+    static bool visit(Visitor& visitor, const Args&... args)
+    {
+        if constexpr (std::is_same_v<std::invoke_result_t<Visitor&, const Args&...>, bool>)
+            return visitor(args...);
+        else
+        {
+            visitor(args...);
+            return true;
+        }
+    }
+
+    static std::uint64_t getKey(std::uint64_t code, std::size_t depth)
+    {
+        return ((code << (2 * (MaxDepth - depth))) << DepthBits) | depth;
+    }
+
+    // First key after the keys of the cell of key and of its descendants
+    static std::uint64_t getCellEnd(std::uint64_t key)
+    {
+        auto depth = key & ((std::uint64_t(1) << DepthBits) - 1);
+        auto shift = 2 * (MaxDepth - depth) + DepthBits;
+        return ((key >> shift) + 1) << shift;
+    }
+
+    std::uint64_t computeKey(const Bounds<Float>& bounds) const
+    {
+        auto box = mBox;
+        auto code = std::uint64_t(0);
+        auto depth = std::size_t(0);
+        for (; depth < MaxDepth; ++depth)
+        {
+            auto i = getQuadrant(box, bounds);
+            if (i == -1)
+                break;
+            code = (code << 2) | static_cast<std::uint64_t>(i);
+            box = computeBox(box, i);
+        }
+        return getKey(code, depth);
+    }
+
+    BoundsArrays<Float> getBoundsArrays() const
+    {
+        return BoundsArrays<Float>{mLefts.data(), mTops.data(), mRights.data(), mBottoms.data()};
+    }
+
+    void reserve(std::size_t n)
+    {
+        mKeys.reserve(n);
+        mValues.reserve(n);
+        mLefts.reserve(n);
+        mTops.reserve(n);
+        mRights.reserve(n);
+        mBottoms.reserve(n);
+    }
+
+    void insert(std::size_t i, std::uint64_t key, const T& value, const Bounds<Float>& bounds)
+    {
+        auto offset = static_cast<std::ptrdiff_t>(i);
+        mKeys.insert(std::begin(mKeys) + offset, key);
+        mValues.insert(std::begin(mValues) + offset, value);
+        mLefts.insert(std::begin(mLefts) + offset, bounds.left);
+        mTops.insert(std::begin(mTops) + offset, bounds.top);
+        mRights.insert(std::begin(mRights) + offset, bounds.right);
+        mBottoms.insert(std::begin(mBottoms) + offset, bounds.bottom);
+    }
+
+    void erase(std::size_t i)
+    {
+        auto offset = static_cast<std::ptrdiff_t>(i);
+        mKeys.erase(std::begin(mKeys) + offset);
+        mValues.erase(std::begin(mValues) + offset);
+        mLefts.erase(std::begin(mLefts) + offset);
+        mTops.erase(std::begin(mTops) + offset);
+        mRights.erase(std::begin(mRights) + offset);
+        mBottoms.erase(std::begin(mBottoms) + offset);
+    }
+
+    // Index of the first key greater or equal to key in [first, last)
+    std::size_t lowerBound(std::size_t first, std::size_t last, std::uint64_t key) const
+    {
+        return static_cast<std::size_t>(std::lower_bound(std::begin(mKeys) + static_cast<std::ptrdiff_t>(first),
+            std::begin(mKeys) + static_cast<std::ptrdiff_t>(last), key) - std::begin(mKeys));
+    }
+
+    // [first, last) is the range of the values of the cell and its descendants
+    template<typename Visitor>
+    bool query(std::size_t depth, std::uint64_t code, const Box<Float>& cellBox, std::size_t first, std::size_t last,
+        const Bounds<Float>& queryBounds, Visitor& visitor) const
+    {
+        auto scan = [this, &queryBounds, &visitor](std::size_t begin, std::size_t end)
+        {
+            return forEachIntersectingBounds(queryBounds, getBoundsArrays(), begin, end,
+                [this, &visitor](std::size_t i){ return visit(visitor, mValues[i]); });
+        };
+        // Small ranges are scanned entirely
+        if (last - first <= ScanThreshold || depth == MaxDepth)
+            return scan(first, last);
+        // The values of the cell itself are before the values of its descendants
+        auto childFirst = lowerBound(first, last, getKey(code, depth) + 1);
+        if (!scan(first, childFirst))
+            return false;
+        for (auto i = std::uint64_t(0); i < 4; ++i)
+        {
+            auto childCode = (code << 2) | i;
+            auto childLast = lowerBound(childFirst, last, getKey(childCode + 1, depth + 1));
+            auto childBox = computeBox(cellBox, static_cast<int>(i));
+            if (childFirst < childLast && queryBounds.intersects(Bounds<Float>::fromBox(childBox)) &&
+                !query(depth + 1, childCode, childBox, childFirst, childLast, queryBounds, visitor))
+                return false;
+            childFirst = childLast;
+        }
+        return true;
+    }
+};
+
+}
@@ -0,0 +1,403 @@
+#pragma once
+
+#include <cassert>
+#include <array>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Box.h"
+#include "NodeStorage.h"
+#include "Parameters.h"
+#include "Quadrant.h"
+#include "Simd.h"
+#include "ValueStorage.h"
+
+namespace quadtree
+{
+
+// Quadtree whose nodes have loose boxes: the box of a node is its cell
+// enlarged by a looseness factor around its center, a value goes down to the
+// child whose cell contains the center of its box as long as the loose box of
+// the child contains it, so that values straddling the center lines of a node
+// are not stuck in it and the depth of a value only depends on its size
+// As loose boxes overlap, values in sibling subtrees can intersect
+template<typename T, typename GetBox, typename Equal = std::equal_to<T>, typename Float = float,
+    typename Storage = PointerStorage, typename Parameters = StaticParameters<>, typename Allocator = std::allocator<T>>
+class LooseQuadtree
+{
+    static_assert(std::is_convertible_v<std::invoke_result_t<GetBox, const T&>, Box<Float>>,
+        "GetBox must be a callable of signature Box<Float>(const T&)");
+    static_assert(std::is_convertible_v<std::invoke_result_t<Equal, const T&, const T&>, bool>,
+        "Equal must be a callable of signature bool(const T&, const T&)");
+    // The margins of the loose boxes are fractions of the cells
+    static_assert(std::is_floating_point_v<Float>, "Float must be a floating point type");
+
+public:
+    // The loose box of a node is looseness times larger than its cell, with a
+    // looseness of 1 the loose boxes are the cells but unlike in Quadtree a
+    // value touching the center lines of a node can go down to a child as the
+    // loose boxes are closed, the nodes and the values are allocated with
+    // allocator
+    LooseQuadtree(const Box<Float>& box, const GetBox& getBox = GetBox(), const Equal& equal = Equal(),
+        Float looseness = Float(2), const Parameters& parameters = Parameters(),
+        const Allocator& allocator = Allocator()) :
+        mBox(box), mMargin((looseness - Float(1)) / Float(2)), mNodes(allocator), mGetBox(getBox), mEqual(equal),
+        mParameters(parameters)
+    {
+        assert(looseness >= Float(1) && "Looseness must be greater or equal to 1");
+    }
+
+    void add(const T& value)
+    {
+        assert(mBox.contains(mGetBox(value)));
+        add(mNodes.getRoot(), 0, mBox, value, Bounds<Float>::fromBox(mGetBox(value)));
+    }
+
+    void remove(const T& value)
+    {
+        assert(mBox.contains(mGetBox(value)));
+        remove(mNodes.getRoot(), mBox, value, Bounds<Float>::fromBox(mGetBox(value)));
+    }
+
+    std::vector<T> query(const Box<Float>& box) const
+    {
+        auto values = std::vector<T>();
+        query(box, std::back_inserter(values));
+        return values;
+    }
+
+    // Call visitor(value) for each value intersecting box, if visitor returns
+    // a bool, the query stops as soon as it returns false
+    // Return false if the query has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&>, bool> query(const Box<Float>& box, Visitor&& visitor) const
+    {
+        return query(mNodes.getRoot(), mBox, Bounds<Float>::fromBox(box), visitor);
+    }
+
+    // Write the values intersecting box in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&>, OutputIt> query(const Box<Float>& box, OutputIt out) const
+    {
+        query(box, [&out](const T& value){ *out++ = value; });
+        return out;
+    }
+
+    std::vector<std::pair<T, T>> findAllIntersections() const
+    {
+        auto intersections = std::vector<std::pair<T, T>>();
+        findAllIntersections(std::back_inserter(intersections));
+        return intersections;
+    }
+
+    // Call visitor(value1, value2) for each pair of intersecting values, if
+    // visitor returns a bool, the search stops as soon as it returns false
+    // Return false if the search has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&, const T&>, bool> findAllIntersections(Visitor&& visitor) const
+    {
+        return findAllIntersections(mNodes.getRoot(), mBox, visitor);
+    }
+
+    // Write the pairs of intersecting values in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&, const T&>, OutputIt> findAllIntersections(OutputIt out) const
+    {
+        findAllIntersections([&out](const T& value1, const T& value2){ *out++ = std::pair<T, T>(value1, value2); });
+        return out;
+    }
+
+    Box<Float> getBox() const
+    {
+        return mBox;
+    }
+
+    Allocator getAllocator() const
+    {
+        return mNodes.getAllocator();
+    }
+
+private:
+    using Values = CachedValueVector<T, Float, Allocator>;
+    using NodeStorage = typename Storage::template NodeStorage<Values, Allocator>;
+    using Node = typename NodeStorage::Node;
+
+    Box<Float> mBox;
+    Float mMargin; // Margin added on each side of a cell relatively to its size
+    NodeStorage mNodes;
+    GetBox mGetBox;
+    Equal mEqual;
+    Parameters mParameters;
+
+    // Call visitor with args and return false if the traversal must stop
+    template<typename Visitor, typename... Args>
+    static bool visit(Visitor& visitor, const Args&... args)
+    {
+        if constexpr (std::is_same_v<std::invoke_result_t<Visitor&, const Args&...>, bool>)
+            return visitor(args...);
+        else
+        {
+            visitor(args...);
+            return true;
+        }
+    }
+
+    bool isLeaf(const Node* node) const
+    {
+        return mNodes.isLeaf(node);
+    }
+
+    // Loose box of the node whose cell is box
+    Bounds<Float> getLooseBounds(const Box<Float>& box) const
+    {
+        auto marginX = mMargin * box.width;
+        auto marginY = mMargin * box.height;
+        return Bounds<Float>{box.left - marginX, box.top - marginY, box.getRight() + marginX,
+            box.getBottom() + marginY};
+    }
+
+    // Child of the node whose cell is box where the value must be stored or
+    // -1 if the value must be stored in the node
+    int getQuadrant(const Box<Float>& box, const Bounds<Float>& valueBounds) const
+    {
+        // The child is given by the center of the value
+        auto center = box.getCenter();
+        auto i = ((valueBounds.left + valueBounds.right) / Float(2) >= center.x ? 1 : 0) +
+            ((valueBounds.top + valueBounds.bottom) / Float(2) >= center.y ? 2 : 0);
+        auto looseBounds = getLooseBounds(computeBox(box, i));
+        if (looseBounds.left <= valueBounds.left && valueBounds.right <= looseBounds.right &&
+            looseBounds.top <= valueBounds.top && valueBounds.bottom <= looseBounds.bottom)
+            return i;
+        else
+            return -1;
+    }
+
+    void add(Node* node, std::size_t depth, const Box<Float>& box, const T& value, const Bounds<Float>& valueBounds)
+    {
+        assert(node != nullptr);
+        if (isLeaf(node))
+        {
+            // Insert the value in this node if possible
+            if (depth >= mParameters.getMaxDepth() || node->values.size() < mParameters.getThreshold())
+                node->values.push_back(value, valueBounds);
+            // Otherwise, we split and we try again
+            else
+            {
+                split(node, box);
+                add(node, depth, box, value, valueBounds);
+            }
+        }
+        else
+        {
+            auto i = getQuadrant(box, valueBounds);
+            // Add the value in a child if it fits in it
+            if (i != -1)
+                add(mNodes.getChild(node, static_cast<std::size_t>(i)), depth + 1, computeBox(box, i), value, valueBounds);
+            // Otherwise, we add the value in the current node
+            else
+                node->values.push_back(value, valueBounds);
+        }
+    }
+
+    void split(Node* node, const Box<Float>& box)
+    {
+        assert(node != nullptr);
+        assert(isLeaf(node) && "Only leaves can be split");
+        // Create children
+        mNodes.createChildren(node);
+        // Assign values to children
+        auto newValues = Values(mNodes.getAllocator()); // New values for this node
+        for (auto j = std::size_t(0); j < node->values.size(); ++j)
+        {
+            auto valueBounds = node->values.getBounds(j, mGetBox);
+            auto i = getQuadrant(box, valueBounds);
+            if (i != -1)
+                mNodes.getChild(node, static_cast<std::size_t>(i))->values.push_back(node->values[j], valueBounds);
+            else
+                newValues.push_back(node->values[j], valueBounds);
+        }
+        node->values.swap(newValues);
+    }
+
+    bool remove(Node* node, const Box<Float>& box, const T& value, const Bounds<Float>& valueBounds)
+    {
+        assert(node != nullptr);
+        if (isLeaf(node))
+        {
+            // Remove the value from node
+            removeValue(node, value);
+            return true;
+        }
+        else
+        {
+            // Remove the value in a child if it fits in it
+            auto i = getQuadrant(box, valueBounds);
+            if (i != -1)
+            {
+                if (remove(mNodes.getChild(node, static_cast<std::size_t>(i)), computeBox(box, i), value, valueBounds))
+                    return tryMerge(node);
+            }
+            // Otherwise, we remove the value from the current node
+            else
+                removeValue(node, value);
+            return false;
+        }
+    }
+
+    void removeValue(Node* node, const T& value)
+    {
+        // Find the value in node->values
+        auto i = std::size_t(0);
+        while (i < node->values.size() && !mEqual(value, node->values[i]))
+            ++i;
+        assert(i < node->values.size() && "Trying to remove a value that is not present in the node");
+        // Swap with the last element and pop back
+        node->values.erase(i);
+    }
+
+    bool tryMerge(Node* node)
+    {
+        assert(node != nullptr);
+        assert(!isLeaf(node) && "Only interior nodes can be merged");
+        auto nbValues = node->values.size();
+        for (auto i = std::size_t(0); i < 4; ++i)
+        {
+            auto child = mNodes.getChild(node, i);
+            if (!isLeaf(child))
+                return false;
+            nbValues += child->values.size();
+        }
+        if (nbValues <= mParameters.getThreshold())
+        {
+            node->values.reserve(nbValues);
+            // Merge the values of all the children
+            for (auto i = std::size_t(0); i < 4; ++i)
+                node->values.append(mNodes.getChild(node, i)->values);
+            // Remove the children
+            mNodes.destroyChildren(node);
+            return true;
+        }
+        else
+            return false;
+    }
+
+    template<typename Visitor>
+    bool query(const Node* node, const Box<Float>& box, const Bounds<Float>& queryBounds, Visitor& visitor) const
+    {
+        assert(node != nullptr);
+        if (!forEachIntersectingBounds(queryBounds, node->values.getBoundsArrays(), 0, node->values.size(),
+            [&visitor, node](std::size_t i){ return visit(visitor, node->values[i]); }))
+            return false;
+        if (!isLeaf(node))
+        {
+            for (auto i = std::size_t(0); i < 4; ++i)
+            {
+                auto childBox = computeBox(box, static_cast<int>(i));
+                if (queryBounds.intersects(getLooseBounds(childBox)) &&
+                    !query(mNodes.getChild(node, i), childBox, queryBounds, visitor))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    template<typename Visitor>
+    bool findAllIntersections(const Node* node, const Box<Float>& box, Visitor& visitor) const
+    {
+        // Find intersections between values stored in this node
+        // Make sure to not report the same intersection twice
+        for (auto i = std::size_t(0); i < node->values.size(); ++i)
+        {
+            if (!forEachIntersectingBounds(node->values.getBounds(i, mGetBox), node->values.getBoundsArrays(), 0, i,
+                [&visitor, node, i](std::size_t j){ return visit(visitor, node->values[i], node->values[j]); }))
+                return false;
+        }
+        if (!isLeaf(node))
+        {
+            auto childBoxes = std::array<Box<Float>, 4>();
+            for (auto i = std::size_t(0); i < 4; ++i)
+                childBoxes[i] = computeBox(box, static_cast<int>(i));
+            // Values in this node can intersect values in descendants
+            for (auto i = std::size_t(0); i < node->values.size(); ++i)
+            {
+                for (auto j = std::size_t(0); j < 4; ++j)
+                {
+                    if (!findIntersectionsInDescendants(mNodes.getChild(node, j), childBoxes[j], node->values[i],
+                        node->values.getBounds(i, mGetBox), visitor))
+                        return false;
+                }
+            }
+            // Values in a subtree can intersect values in sibling subtrees whose loose boxes overlap
+            for (auto i = std::size_t(0); i < 4; ++i)
+            {
+                for (auto j = i + 1; j < 4; ++j)
+                {
+                    if (getLooseBounds(childBoxes[i]).intersects(getLooseBounds(childBoxes[j])) &&
+                        !findIntersectionsBetween(mNodes.getChild(node, i), childBoxes[i], mNodes.getChild(node, j),
+                            childBoxes[j], visitor))
+                        return false;
+                }
+            }
+            // Find intersections in children
+            for (auto i = std::size_t(0); i < 4; ++i)
+            {
+                if (!findAllIntersections(mNodes.getChild(node, i), childBoxes[i], visitor))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // Find the intersections between the values of the subtree of node1 and the values of the subtree of node2
+    template<typename Visitor>
+    bool findIntersectionsBetween(const Node* node1, const Box<Float>& box1, const Node* node2,
+        const Box<Float>& box2, Visitor& visitor) const
+    {
+        for (auto i = std::size_t(0); i < node1->values.size(); ++i)
+        {
+            if (!findIntersectionsInDescendants(node2, box2, node1->values[i], node1->values.getBounds(i, mGetBox),
+                visitor))
+                return false;
+        }
+        if (!isLeaf(node1))
+        {
+            auto looseBounds2 = getLooseBounds(box2);
+            for (auto i = std::size_t(0); i < 4; ++i)
+            {
+                auto childBox = computeBox(box1, static_cast<int>(i));
+                if (getLooseBounds(childBox).intersects(looseBounds2) &&
+                    !findIntersectionsBetween(mNodes.getChild(node1, i), childBox, node2, box2, visitor))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // Find the intersections between value and the values of the subtree of node
+    template<typename Visitor>
+    bool findIntersectionsInDescendants(const Node* node, const Box<Float>& box, const T& value,
+        const Bounds<Float>& valueBounds, Visitor& visitor) const
+    {
+        if (!valueBounds.intersects(getLooseBounds(box)))
+            return true;
+        // Test against the values stored in this node
+        if (!forEachIntersectingBounds(valueBounds, node->values.getBoundsArrays(), 0, node->values.size(),
+            [&visitor, &value, node](std::size_t i){ return visit(visitor, value, node->values[i]); }))
+            return false;
+        // Test against values stored into descendants of this node
+        if (!isLeaf(node))
+        {
+            for (auto i = std::size_t(0); i < 4; ++i)
+            {
+                if (!findIntersectionsInDescendants(mNodes.getChild(node, i), computeBox(box, static_cast<int>(i)),
+                    value, valueBounds, visitor))
+                    return false;
+            }
+        }
+        return true;
+    }
+};
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace quadtree
+{
+
+// Read-only memory mapping of a whole file, the pages are shared with the
+// other processes mapping the same file, POSIX only
+class MappedFile
+{
+public:
+    // Throw std::system_error if the file can not be mapped
+    explicit MappedFile(const std::string& path)
+    {
+        auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+            throw std::system_error(errno, std::generic_category(), "Can not open " + path);
+        struct stat status;
+        if (::fstat(fd, &status) == -1)
+        {
+            auto error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "Can not stat " + path);
+        }
+        mSize = static_cast<std::size_t>(status.st_size);
+        if (mSize > 0)
+        {
+            mData = ::mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0);
+            if (mData == MAP_FAILED)
+            {
+                auto error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "Can not map " + path);
+            }
+        }
+        // The mapping remains valid after the file is closed
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept :
+        mData(std::exchange(other.mData, nullptr)), mSize(std::exchange(other.mSize, 0))
+    {
+
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        std::swap(mData, other.mData);
+        std::swap(mSize, other.mSize);
+        return *this;
+    }
+
+    ~MappedFile()
+    {
+        if (mData != nullptr)
+            ::munmap(mData, mSize);
+    }
+
+    // Page aligned
+    const void* getData() const
+    {
+        return mData;
+    }
+
+    std::size_t getSize() const
+    {
+        return mSize;
+    }
+
+private:
+    void* mData = nullptr;
+    std::size_t mSize = 0;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include "Box.h"
+
+namespace quadtree
+{
+
+// Insert a zero bit between each of the 32 lower bits of x
+constexpr std::uint64_t spreadBits(std::uint64_t x) noexcept
+{
+    x &= 0x00000000ffffffff;
+    x = (x | (x << 16)) & 0x0000ffff0000ffff;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0f;
+    x = (x | (x << 2)) & 0x3333333333333333;
+    x = (x | (x << 1)) & 0x5555555555555555;
+    return x;
+}
+
+// Interleave the bits of x and y, the bits of x are the even bits of the code
+constexpr std::uint64_t encodeMorton(std::uint32_t x, std::uint32_t y) noexcept
+{
+    return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+// Index of the cell containing position in a grid of 2^depth x 2^depth cells
+// covering box, positions outside of box are clamped to the border cells
+template<typename Float>
+std::uint32_t computeCell(Float position, Float origin, Float size, std::size_t depth) noexcept
+{
+    auto nbCells = std::uint64_t(1) << depth;
+    auto t = static_cast<double>(position - origin) / static_cast<double>(size) * static_cast<double>(nbCells);
+    return static_cast<std::uint32_t>(std::clamp(t, 0.0, static_cast<double>(nbCells - 1)));
+}
+
+// Morton code of the cell containing point in a grid of 2^depth x 2^depth
+// cells covering box, depth must be at most 32
+template<typename Float>
+std::uint64_t computeMortonCode(const Box<Float>& box, const Vector2<Float>& point, std::size_t depth) noexcept
+{
+    return encodeMorton(computeCell(point.x, box.left, box.width, depth),
+        computeCell(point.y, box.top, box.height, depth));
+}
+
+}
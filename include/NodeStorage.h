@@ -0,0 +1,310 @@
+#pragma once
+
+#include <cassert>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace quadtree
+{
+
+// Node storages allocate the nodes with Allocator and construct the values of
+// the nodes with it, so that all the memory of a tree comes from it
+// The interior nodes have NbChildren children, four for a quadtree
+
+// Each group of children is allocated separately on the heap
+struct PointerStorage
+{
+    template<typename Values, typename Allocator = std::allocator<Values>, std::size_t NbChildren = 4>
+    class NodeStorage
+    {
+    public:
+        struct Node
+        {
+            explicit Node(const Allocator& allocator) : values(allocator)
+            {
+
+            }
+
+            std::array<Node*, NbChildren> children = {};
+            Values values;
+        };
+
+        explicit NodeStorage(const Allocator& allocator = Allocator()) :
+            mAllocator(allocator), mRoot(createNode())
+        {
+
+        }
+
+        NodeStorage(const NodeStorage&) = delete;
+        NodeStorage& operator=(const NodeStorage&) = delete;
+
+        NodeStorage(NodeStorage&& other) noexcept :
+            mAllocator(other.mAllocator), mRoot(std::exchange(other.mRoot, nullptr)),
+            mNbNodes(std::exchange(other.mNbNodes, 0))
+        {
+
+        }
+
+        // The allocators are not propagated so they must be equal
+        NodeStorage& operator=(NodeStorage&& other) noexcept
+        {
+            assert(mAllocator == other.mAllocator && "The allocators must be equal");
+            std::swap(mRoot, other.mRoot);
+            std::swap(mNbNodes, other.mNbNodes);
+            return *this;
+        }
+
+        ~NodeStorage()
+        {
+            if (mRoot != nullptr)
+                destroyNode(mRoot);
+        }
+
+        Allocator getAllocator() const
+        {
+            return Allocator(mAllocator);
+        }
+
+        Node* getRoot()
+        {
+            return mRoot;
+        }
+
+        const Node* getRoot() const
+        {
+            return mRoot;
+        }
+
+        bool isLeaf(const Node* node) const
+        {
+            return node->children[0] == nullptr;
+        }
+
+        Node* getChild(Node* node, std::size_t i)
+        {
+            return node->children[i];
+        }
+
+        const Node* getChild(const Node* node, std::size_t i) const
+        {
+            return node->children[i];
+        }
+
+        void createChildren(Node* node)
+        {
+            for (auto& child : node->children)
+                child = createNode();
+            mNbNodes += NbChildren;
+        }
+
+        void destroyChildren(Node* node)
+        {
+            for (auto& child : node->children)
+                destroyNode(std::exchange(child, nullptr));
+            mNbNodes -= NbChildren;
+        }
+
+        // Heap memory used by the nodes in bytes, the memory of values is not included
+        std::size_t getMemoryUsage() const
+        {
+            return mNbNodes * sizeof(Node);
+        }
+
+    private:
+        using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+        using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+        NodeAllocator mAllocator;
+        Node* mRoot;
+        std::size_t mNbNodes = 1;
+
+        Node* createNode()
+        {
+            auto node = NodeAllocatorTraits::allocate(mAllocator, 1);
+            NodeAllocatorTraits::construct(mAllocator, node, getAllocator());
+            return node;
+        }
+
+        // Destroy node and its descendants
+        void destroyNode(Node* node)
+        {
+            if (!isLeaf(node))
+            {
+                for (auto child : node->children)
+                    destroyNode(child);
+            }
+            NodeAllocatorTraits::destroy(mAllocator, node);
+            NodeAllocatorTraits::deallocate(mAllocator, node, 1);
+        }
+    };
+};
+
+// Children are stored as groups of contiguous nodes in an arena and are
+// addressed by a 32-bit index, groups of destroyed children are recycled
+struct PooledStorage
+{
+    template<typename Values, typename Allocator = std::allocator<Values>, std::size_t NbChildren = 4>
+    class NodeStorage
+    {
+    public:
+        struct Node
+        {
+            explicit Node(const Allocator& allocator) : values(allocator)
+            {
+
+            }
+
+            std::uint32_t firstChild = Null;
+            Values values;
+        };
+
+        explicit NodeStorage(const Allocator& allocator = Allocator()) :
+            mAllocator(allocator), mRoot(allocator), mBlocks(BlockAllocator(allocator))
+        {
+
+        }
+
+        NodeStorage(const NodeStorage&) = delete;
+        NodeStorage& operator=(const NodeStorage&) = delete;
+
+        NodeStorage(NodeStorage&& other) noexcept :
+            mAllocator(other.mAllocator), mRoot(std::move(other.mRoot)), mBlocks(std::move(other.mBlocks)),
+            mSize(std::exchange(other.mSize, 0)), mFreeList(std::exchange(other.mFreeList, Null))
+        {
+            other.mRoot.firstChild = Null;
+            other.mBlocks.clear();
+        }
+
+        // The allocators are not propagated so they must be equal
+        NodeStorage& operator=(NodeStorage&& other) noexcept
+        {
+            assert(mAllocator == other.mAllocator && "The allocators must be equal");
+            std::swap(mRoot, other.mRoot);
+            mBlocks.swap(other.mBlocks);
+            std::swap(mSize, other.mSize);
+            std::swap(mFreeList, other.mFreeList);
+            return *this;
+        }
+
+        ~NodeStorage()
+        {
+            for (auto block : mBlocks)
+            {
+                for (auto i = std::size_t(0); i < BlockSize; ++i)
+                    NodeAllocatorTraits::destroy(mAllocator, block + i);
+                NodeAllocatorTraits::deallocate(mAllocator, block, BlockSize);
+            }
+        }
+
+        Allocator getAllocator() const
+        {
+            return Allocator(mAllocator);
+        }
+
+        Node* getRoot()
+        {
+            return &mRoot;
+        }
+
+        const Node* getRoot() const
+        {
+            return &mRoot;
+        }
+
+        bool isLeaf(const Node* node) const
+        {
+            return node->firstChild == Null;
+        }
+
+        Node* getChild(Node* node, std::size_t i)
+        {
+            return getNode(node->firstChild + static_cast<std::uint32_t>(i));
+        }
+
+        const Node* getChild(const Node* node, std::size_t i) const
+        {
+            return getNode(node->firstChild + static_cast<std::uint32_t>(i));
+        }
+
+        void createChildren(Node* node)
+        {
+            assert(isLeaf(node));
+            // Reuse a free group if possible
+            if (mFreeList != Null)
+            {
+                node->firstChild = mFreeList;
+                auto first = getNode(mFreeList);
+                mFreeList = first->firstChild;
+                first->firstChild = Null;
+            }
+            // Otherwise, take a new group at the end of the arena
+            else
+            {
+                assert(mSize <= Null - NbChildren && "Too many nodes");
+                if (mSize == mBlocks.size() * BlockSize)
+                    createBlock();
+                node->firstChild = mSize;
+                mSize += static_cast<std::uint32_t>(NbChildren);
+            }
+        }
+
+        void destroyChildren(Node* node)
+        {
+            assert(!isLeaf(node));
+            // Values are cleared but their memory is kept for the next use of the group
+            for (auto i = std::size_t(0); i < NbChildren; ++i)
+            {
+                auto child = getChild(node, i);
+                assert(isLeaf(child) && "Only leaves can be destroyed");
+                child->values.clear();
+            }
+            // Add the group to the free list
+            getNode(node->firstChild)->firstChild = mFreeList;
+            mFreeList = node->firstChild;
+            node->firstChild = Null;
+        }
+
+        // Heap memory used by the nodes in bytes, the memory of values is not included
+        std::size_t getMemoryUsage() const
+        {
+            return mBlocks.size() * BlockSize * sizeof(Node) + mBlocks.capacity() * sizeof(Node*);
+        }
+
+    private:
+        static constexpr auto Null = std::numeric_limits<std::uint32_t>::max();
+        static constexpr auto BlockShift = std::uint32_t(10);
+        static constexpr auto BlockSize = std::uint32_t(1) << BlockShift; // Must be a multiple of NbChildren
+        static constexpr auto BlockMask = BlockSize - 1;
+        static_assert(BlockSize % NbChildren == 0, "The groups of children must not straddle blocks");
+
+        using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+        using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+        using BlockAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node*>;
+
+        NodeAllocator mAllocator;
+        Node mRoot;
+        // Blocks are never reallocated so that pointers to nodes remain valid
+        std::vector<Node*, BlockAllocator> mBlocks;
+        std::uint32_t mSize = 0;
+        std::uint32_t mFreeList = Null;
+
+        Node* getNode(std::uint32_t index) const
+        {
+            return &mBlocks[index >> BlockShift][index & BlockMask];
+        }
+
+        void createBlock()
+        {
+            auto block = NodeAllocatorTraits::allocate(mAllocator, BlockSize);
+            for (auto i = std::size_t(0); i < BlockSize; ++i)
+                NodeAllocatorTraits::construct(mAllocator, block + i, getAllocator());
+            mBlocks.push_back(block);
+        }
+    };
+};
+
+}
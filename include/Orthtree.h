@@ -0,0 +1,304 @@
+#pragma once
+
+#include <cassert>
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Box.h"
+#include "NodeStorage.h"
+#include "OrthtreeBase.h"
+#include "Parameters.h"
+#include "Quadrant.h"
+#include "TraversalStack.h"
+
+namespace quadtree
+{
+
+// Tree in dimension D whose interior nodes have 2^D children: a quadtree in
+// dimension 2 and an octree in dimension 3
+// The nodes are added, removed, split and merged by OrthtreeBase like in
+// Quadtree, the queries are generic over the dimension
+// D is at most 4 as the traversal stacks hold up to 2^D - 1 boxes per level
+template<typename T, typename GetBox, std::size_t D, typename Equal = std::equal_to<T>, typename Float = float,
+    typename Storage = PointerStorage, typename Parameters = StaticParameters<>, typename Allocator = std::allocator<T>>
+class Orthtree : public OrthtreeBase<T, GetBox, D, Equal, Float, Storage, false, Parameters, Allocator, false>
+{
+    static_assert(D > 0 && D <= 4, "D must be between 1 and 4");
+    static_assert(std::is_convertible_v<std::invoke_result_t<GetBox, const T&>, Box<Float, D>>,
+        "GetBox must be a callable of signature Box<Float, D>(const T&)");
+    static_assert(std::is_convertible_v<std::invoke_result_t<Equal, const T&, const T&>, bool>,
+        "Equal must be a callable of signature bool(const T&, const T&)");
+    static_assert(std::is_arithmetic_v<Float>);
+
+    using Base = OrthtreeBase<T, GetBox, D, Equal, Float, Storage, false, Parameters, Allocator, false>;
+
+public:
+    using Base::NbChildren;
+
+    // The nodes and the values are allocated with allocator
+    Orthtree(const Box<Float, D>& box, const GetBox& getBox = GetBox(), const Equal& equal = Equal(),
+        const Parameters& parameters = Parameters(), const Allocator& allocator = Allocator()) :
+        Base(box, getBox, equal, parameters, allocator)
+    {
+
+    }
+
+    void add(const T& value)
+    {
+        assert(mBox.contains(mGetBox(value)));
+        add(mNodes.getRoot(), 0, mBox, value, Bounds<Float, D>::fromBox(mGetBox(value)), 0);
+    }
+
+    void remove(const T& value)
+    {
+        assert(mBox.contains(mGetBox(value)));
+        auto find = [this, &value](const Node* node)
+        {
+            return findValue(node, value);
+        };
+        remove(mNodes.getRoot(), mBox, Bounds<Float, D>::fromBox(mGetBox(value)), find);
+    }
+
+    // Move value from oldBox to its current box, only the nodes below the
+    // last node containing both boxes are modified
+    void update(const T& value, const Box<Float, D>& oldBox)
+    {
+        assert(mBox.contains(oldBox));
+        assert(mBox.contains(mGetBox(value)));
+        auto find = [this, &value](const Node* node)
+        {
+            return findValue(node, value);
+        };
+        update(mNodes.getRoot(), 0, mBox, value, Bounds<Float, D>::fromBox(oldBox),
+            Bounds<Float, D>::fromBox(mGetBox(value)), find);
+    }
+
+    std::vector<T> query(const Box<Float, D>& box) const
+    {
+        auto values = std::vector<T>();
+        query(box, std::back_inserter(values));
+        return values;
+    }
+
+    // Call visitor(value) for each value intersecting box, if visitor returns
+    // a bool, the query stops as soon as it returns false
+    // Return false if the query has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&>, bool> query(const Box<Float, D>& box,
+        Visitor&& visitor) const
+    {
+        if (!mBox.intersects(box))
+            return true;
+        return query(mNodes.getRoot(), mBox, Bounds<Float, D>::fromBox(box), visitor);
+    }
+
+    // Write the values intersecting box in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&>, OutputIt> query(const Box<Float, D>& box,
+        OutputIt out) const
+    {
+        query(box, [&out](const T& value){ *out++ = value; });
+        return out;
+    }
+
+    std::vector<std::pair<T, T>> findAllIntersections() const
+    {
+        auto intersections = std::vector<std::pair<T, T>>();
+        findAllIntersections(std::back_inserter(intersections));
+        return intersections;
+    }
+
+    // Call visitor(value1, value2) for each pair of intersecting values, if
+    // visitor returns a bool, the search stops as soon as it returns false
+    // Return false if the search has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&, const T&>, bool> findAllIntersections(
+        Visitor&& visitor) const
+    {
+        return findAllIntersections(mNodes.getRoot(), visitor);
+    }
+
+    // Write the pairs of intersecting values in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&, const T&>, OutputIt> findAllIntersections(
+        OutputIt out) const
+    {
+        findAllIntersections([&out](const T& value1, const T& value2){ *out++ = std::pair<T, T>(value1, value2); });
+        return out;
+    }
+
+private:
+    // Nodes with fewer values are tested pair by pair, larger ones are swept
+    // along the first axis like in Quadtree
+    static constexpr auto SweepMinValues = std::size_t(16);
+
+    using typename Base::Node;
+
+    using Base::mBox;
+    using Base::mNodes;
+    using Base::mGetBox;
+    using Base::isLeaf;
+    using Base::add;
+    using Base::remove;
+    using Base::update;
+    using Base::findValue;
+    using Base::visit;
+
+    // Value with its bounds, sorted by the start of its bounds along the first axis
+    struct SweepEntry
+    {
+        Bounds<Float, D> bounds;
+        const T* value;
+    };
+
+    // Node pending in a traversal with its box in plain members so that the
+    // stack is not initialized
+    struct BoxedNode
+    {
+        const Node* node;
+        std::array<Float, D> position;
+        std::array<Float, D> size;
+
+        BoxedNode() = default;
+
+        BoxedNode(const Node* Node, const Box<Float, D>& box) : node(Node)
+        {
+            for (auto axis = std::size_t(0); axis < D; ++axis)
+            {
+                position[axis] = box.getPosition()[axis];
+                size[axis] = box.getSize()[axis];
+            }
+        }
+
+        Box<Float, D> getBox() const
+        {
+            auto boxPosition = Vector<Float, D>();
+            auto boxSize = Vector<Float, D>();
+            for (auto axis = std::size_t(0); axis < D; ++axis)
+            {
+                boxPosition[axis] = position[axis];
+                boxSize[axis] = size[axis];
+            }
+            return Box<Float, D>(boxPosition, boxSize);
+        }
+    };
+
+    // Call visitor(value) for each value of the subtree of root intersecting queryBounds
+    template<typename Visitor>
+    bool query(const Node* root, const Box<Float, D>& rootBox, const Bounds<Float, D>& queryBounds,
+        Visitor& visitor) const
+    {
+        auto stack = TraversalStack<BoxedNode, Parameters::getMaxDepthBound(), NbChildren>();
+        stack.push(BoxedNode{root, rootBox});
+        while (!stack.empty())
+        {
+            auto entry = stack.pop();
+            auto box = entry.getBox();
+            const auto& values = entry.node->values;
+            for (auto i = std::size_t(0); i < values.size(); ++i)
+            {
+                if (queryBounds.intersects(values.getBounds(i, mGetBox)) && !visit(visitor, values[i]))
+                    return false;
+            }
+            if (!isLeaf(entry.node))
+            {
+                // Children are pushed in reverse order so that they are visited in order
+                for (auto i = NbChildren; i-- > 0;)
+                {
+                    auto childBox = computeBox(box, static_cast<int>(i));
+                    stack.pushIf(BoxedNode{mNodes.getChild(entry.node, i), childBox},
+                        queryBounds.intersects(Bounds<Float, D>::fromBox(childBox)));
+                }
+            }
+        }
+        return true;
+    }
+
+    template<typename Visitor>
+    bool findAllIntersections(const Node* root, Visitor& visitor) const
+    {
+        auto stack = TraversalStack<BoxedNode, Parameters::getMaxDepthBound(), NbChildren>();
+        stack.push(BoxedNode{root, mBox});
+        auto entries = std::vector<SweepEntry>(); // Reused by all the nodes
+        while (!stack.empty())
+        {
+            auto entry = stack.pop();
+            auto node = entry.node;
+            auto box = entry.getBox();
+            if (!findIntersectionsInNode(node, visitor, entries))
+                return false;
+            if (!isLeaf(node))
+            {
+                for (auto i = NbChildren; i-- > 0;)
+                {
+                    auto child = mNodes.getChild(node, i);
+                    auto childBox = computeBox(box, static_cast<int>(i));
+                    auto childBounds = Bounds<Float, D>::fromBox(childBox);
+                    // Values in this node can intersect values in the descendants whose boxes they intersect
+                    for (auto j = std::size_t(0); j < node->values.size(); ++j)
+                    {
+                        auto valueBounds = node->values.getBounds(j, mGetBox);
+                        const auto& value = node->values[j];
+                        auto valueVisitor = [&visitor, &value](const T& other){ return visit(visitor, value, other); };
+                        if (valueBounds.intersects(childBounds) && !query(child, childBox, valueBounds, valueVisitor))
+                            return false;
+                    }
+                    // Find intersections in children
+                    stack.push(BoxedNode{child, childBox});
+                }
+            }
+        }
+        return true;
+    }
+
+    template<typename Visitor>
+    bool findIntersectionsInNode(const Node* node, Visitor& visitor, std::vector<SweepEntry>& entries) const
+    {
+        const auto& values = node->values;
+        if (values.size() >= SweepMinValues)
+        {
+            entries.clear();
+            for (auto i = std::size_t(0); i < values.size(); ++i)
+                entries.push_back(SweepEntry{values.getBounds(i, mGetBox), &values[i]});
+            std::sort(std::begin(entries), std::end(entries), [](const SweepEntry& lhs, const SweepEntry& rhs)
+            {
+                return lhs.bounds.getLower()[0] < rhs.bounds.getLower()[0];
+            });
+            // Each entry is only tested against the next entries starting before its end
+            for (auto i = std::size_t(0); i < entries.size(); ++i)
+            {
+                auto end = entries[i].bounds.getUpper()[0];
+                for (auto j = i + 1; j < entries.size() && entries[j].bounds.getLower()[0] < end; ++j)
+                {
+                    if (entries[i].bounds.intersects(entries[j].bounds) &&
+                        !visit(visitor, *entries[j].value, *entries[i].value))
+                        return false;
+                }
+            }
+            return true;
+        }
+        // Find intersections between values stored in this node
+        // Make sure to not report the same intersection twice
+        for (auto i = std::size_t(0); i < values.size(); ++i)
+        {
+            auto valueBounds = values.getBounds(i, mGetBox);
+            for (auto j = std::size_t(0); j < i; ++j)
+            {
+                if (valueBounds.intersects(values.getBounds(j, mGetBox)) && !visit(visitor, values[i], values[j]))
+                    return false;
+            }
+        }
+        return true;
+    }
+};
+
+template<typename T, typename GetBox, typename Equal = std::equal_to<T>, typename Float = float,
+    typename Storage = PointerStorage, typename Parameters = StaticParameters<>, typename Allocator = std::allocator<T>>
+using Octree = Orthtree<T, GetBox, 3, Equal, Float, Storage, Parameters, Allocator>;
+
+}
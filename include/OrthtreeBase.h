@@ -0,0 +1,377 @@
+#pragma once
+
+#include <cassert>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "Bounds.h"
+#include "Box.h"
+#include "HandleTable.h"
+#include "NodeStorage.h"
+#include "Quadrant.h"
+#include "Stats.h"
+#include "ValueStorage.h"
+
+namespace quadtree
+{
+
+// Nodes of a tree in dimension D whose interior nodes have 2^D children and
+// the operations modifying them, shared by Quadtree, which is the case D = 2,
+// and Orthtree
+// The boxes can only be cached and the handles can only be enabled in
+// dimension 2
+template<typename T, typename GetBox, std::size_t D, typename Equal, typename Float, typename Storage,
+    bool CacheBoxes, typename Parameters, typename Allocator, bool Handles>
+class OrthtreeBase
+{
+    static_assert(D == 2 || (!CacheBoxes && !Handles), "Boxes can only be cached and handles enabled in dimension 2");
+
+public:
+    Box<Float, D> getBox() const
+    {
+        return mBox;
+    }
+
+    Allocator getAllocator() const
+    {
+        return mNodes.getAllocator();
+    }
+
+    // Work done by the operations since the last reset, the counters are
+    // only updated if QUADTREE_STATS is defined
+    OperationCounters getCounters() const
+    {
+        return mCounters.get();
+    }
+
+    void resetCounters()
+    {
+        mCounters.reset();
+    }
+
+    // Traverse the tree to describe its shape
+    TreeStats getStats() const
+    {
+        auto stats = TreeStats();
+        stats.memoryUsage = sizeof(*this) + mNodes.getMemoryUsage();
+        if constexpr (Handles)
+            stats.memoryUsage += mHandles.getMemoryUsage();
+        computeStats(mNodes.getRoot(), 0, stats);
+        return stats;
+    }
+
+protected:
+    static constexpr auto NbChildren = std::size_t(1) << D;
+
+    using BaseValues = std::conditional_t<CacheBoxes, CachedValueVector<T, Float, Allocator>,
+        ValueVector<T, Float, Allocator, D>>;
+    using Values = std::conditional_t<Handles, HandleValueVector<BaseValues, T, Float, Allocator>, BaseValues>;
+    using NodeStorage = typename Storage::template NodeStorage<Values, Allocator, NbChildren>;
+    using Node = typename NodeStorage::Node;
+
+    // Handle table of the trees without handles
+    struct NoHandleTable
+    {
+        explicit NoHandleTable(const Allocator&)
+        {
+
+        }
+    };
+    using HandleTable = std::conditional_t<Handles, quadtree::HandleTable<Node, Allocator>, NoHandleTable>;
+
+    // Find the value of a handle in the node where the handle locates it
+    struct KnownLocation
+    {
+        const Node* node;
+        std::size_t i;
+
+        std::size_t operator()([[maybe_unused]] const Node* current) const
+        {
+            assert(current == node && "The box of the value is not the one used to locate it");
+            return i;
+        }
+    };
+
+    Box<Float, D> mBox;
+    NodeStorage mNodes;
+    GetBox mGetBox;
+    Equal mEqual;
+    Parameters mParameters;
+    HandleTable mHandles; // Empty if Handles is false
+    mutable AtomicOperationCounters<StatsEnabled> mCounters;
+
+    // The nodes and the values are allocated with allocator
+    OrthtreeBase(const Box<Float, D>& box, const GetBox& getBox, const Equal& equal, const Parameters& parameters,
+        const Allocator& allocator) :
+        mBox(box), mNodes(allocator), mGetBox(getBox), mEqual(equal), mParameters(parameters), mHandles(allocator)
+    {
+
+    }
+
+    bool isLeaf(const Node* node) const
+    {
+        return mNodes.isLeaf(node);
+    }
+
+    std::array<Node*, NbChildren> getChildren(Node* node)
+    {
+        auto children = std::array<Node*, NbChildren>();
+        for (auto i = std::size_t(0); i < NbChildren; ++i)
+            children[i] = mNodes.getChild(node, i);
+        return children;
+    }
+
+    // handle is the index of the handle of the value, it is ignored if Handles is false
+    void add(Node* node, std::size_t depth, const Box<Float, D>& box, const T& value,
+        const Bounds<Float, D>& valueBounds, std::uint32_t handle)
+    {
+        assert(node != nullptr);
+        mCounters.addNodesVisited(1);
+        if (isLeaf(node))
+        {
+            // Insert the value in this node if possible
+            if (depth >= mParameters.getMaxDepth() || node->values.size() < mParameters.getThreshold())
+                pushValue(node, value, valueBounds, handle);
+            // Otherwise, we split and we try again
+            else
+            {
+                split(node, box);
+                add(node, depth, box, value, valueBounds, handle);
+            }
+        }
+        else
+        {
+            auto i = getQuadrant(box, valueBounds);
+            // Add the value in a child if the value is entirely contained in it
+            if (i != -1)
+            {
+                add(mNodes.getChild(node, static_cast<std::size_t>(i)), depth + 1, computeBox(box, i), value,
+                    valueBounds, handle);
+            }
+            // Otherwise, we add the value in the current node
+            else
+                pushValue(node, value, valueBounds, handle);
+        }
+    }
+
+    void split(Node* node, const Box<Float, D>& box)
+    {
+        assert(node != nullptr);
+        assert(isLeaf(node) && "Only leaves can be split");
+        mCounters.addSplit();
+        mCounters.addAllocation();
+        // Create children
+        mNodes.createChildren(node);
+        // Assign values to children
+        auto newValues = Values(mNodes.getAllocator()); // New values for this node
+        for (auto j = std::size_t(0); j < node->values.size(); ++j)
+        {
+            auto valueBounds = node->values.getBounds(j, mGetBox);
+            auto i = getQuadrant(box, valueBounds);
+            auto handle = getHandle(node->values, j);
+            if (i != -1)
+                pushValue(mNodes.getChild(node, static_cast<std::size_t>(i)), node->values[j], valueBounds, handle);
+            else if constexpr (Handles)
+                newValues.push_back(node->values[j], valueBounds, handle);
+            else
+                newValues.push_back(node->values[j], valueBounds);
+        }
+        node->values.swap(newValues);
+        setLocations(node, 0);
+    }
+
+    // find(node) must return the index of the value in node, the node
+    // containing the value
+    template<typename Find>
+    bool remove(Node* node, const Box<Float, D>& box, const Bounds<Float, D>& valueBounds, Find& find)
+    {
+        assert(node != nullptr);
+        mCounters.addNodesVisited(1);
+        if (isLeaf(node))
+        {
+            // Remove the value from node
+            removeValue(node, find(node));
+            return true;
+        }
+        else
+        {
+            // Remove the value in a child if the value is entirely contained in it
+            auto i = getQuadrant(box, valueBounds);
+            if (i != -1)
+            {
+                if (remove(mNodes.getChild(node, static_cast<std::size_t>(i)), computeBox(box, i), valueBounds, find))
+                    return tryMerge(node);
+            }
+            // Otherwise, we remove the value from the current node
+            else
+                removeValue(node, find(node));
+            return false;
+        }
+    }
+
+    template<typename Find>
+    void update(Node* node, std::size_t depth, const Box<Float, D>& box, const T& value,
+        const Bounds<Float, D>& oldBounds, const Bounds<Float, D>& newBounds, Find& find)
+    {
+        assert(node != nullptr);
+        mCounters.addNodesVisited(1);
+        auto oldI = isLeaf(node) ? -1 : getQuadrant(box, oldBounds);
+        auto newI = isLeaf(node) ? -1 : getQuadrant(box, newBounds);
+        // The value stays in this node
+        if (oldI == -1 && newI == -1)
+        {
+            if constexpr (CacheBoxes)
+                node->values.setBounds(find(node), newBounds);
+        }
+        // The value stays in the same child
+        else if (oldI == newI)
+        {
+            auto i = static_cast<std::size_t>(oldI);
+            update(mNodes.getChild(node, i), depth + 1, computeBox(box, oldI), value, oldBounds, newBounds, find);
+        }
+        // The value moves to another node in this subtree, it keeps its handle
+        else
+        {
+            auto handle = std::uint32_t(0);
+            auto findAndKeepHandle = [this, &find, &handle](const Node* current)
+            {
+                auto i = find(current);
+                handle = getHandle(current->values, i);
+                return i;
+            };
+            remove(node, box, oldBounds, findAndKeepHandle);
+            add(node, depth, box, value, newBounds, handle);
+        }
+    }
+
+    std::size_t findValue(const Node* node, const T& value) const
+    {
+        auto i = std::size_t(0);
+        while (i < node->values.size() && !mEqual(value, node->values[i]))
+            ++i;
+        assert(i < node->values.size() && "The value is not present in the node");
+        return i;
+    }
+
+    void removeValue(Node* node, std::size_t i)
+    {
+        // Swap with the last element and pop back
+        node->values.erase(i);
+        if (i < node->values.size())
+            setLocation(node, i);
+    }
+
+    void pushValue(Node* node, const T& value, const Bounds<Float, D>& valueBounds, std::uint32_t handle)
+    {
+        if constexpr (Handles)
+        {
+            node->values.push_back(value, valueBounds, handle);
+            setLocation(node, node->values.size() - 1);
+        }
+        else
+            node->values.push_back(value, valueBounds);
+    }
+
+    static std::uint32_t getHandle(const Values& values, std::size_t i)
+    {
+        if constexpr (Handles)
+            return values.getHandle(i);
+        else
+            return 0;
+    }
+
+    std::pair<Node*, std::size_t> getLocation(Handle handle)
+    {
+        const auto& location = mHandles.get(handle);
+        // The root is not stored as its address changes when PooledStorage is moved
+        return {location.node != nullptr ? location.node : mNodes.getRoot(), location.position};
+    }
+
+    // Store the location of the i-th value of node in the handle table
+    void setLocation(Node* node, std::size_t i)
+    {
+        if constexpr (Handles)
+            mHandles.set(node->values.getHandle(i), node != mNodes.getRoot() ? node : nullptr, i);
+    }
+
+    void setLocations(Node* node, std::size_t first)
+    {
+        if constexpr (Handles)
+        {
+            for (auto i = first; i < node->values.size(); ++i)
+                setLocation(node, i);
+        }
+    }
+
+    bool tryMerge(Node* node)
+    {
+        assert(node != nullptr);
+        assert(!isLeaf(node) && "Only interior nodes can be merged");
+        auto nbValues = node->values.size();
+        for (auto i = std::size_t(0); i < NbChildren; ++i)
+        {
+            auto child = mNodes.getChild(node, i);
+            if (!isLeaf(child))
+                return false;
+            nbValues += child->values.size();
+        }
+        if (nbValues <= mParameters.getThreshold())
+        {
+            auto first = node->values.size();
+            node->values.reserve(nbValues);
+            // Merge the values of all the children
+            for (auto i = std::size_t(0); i < NbChildren; ++i)
+                node->values.append(mNodes.getChild(node, i)->values);
+            setLocations(node, first);
+            // Remove the children
+            mNodes.destroyChildren(node);
+            mCounters.addMerge();
+            return true;
+        }
+        else
+            return false;
+    }
+
+    void computeStats(const Node* node, std::size_t depth, TreeStats& stats) const
+    {
+        auto nbValues = node->values.size();
+        ++stats.nbNodes;
+        stats.nbValues += nbValues;
+        stats.memoryUsage += node->values.getMemoryUsage();
+        if (stats.nbNodesPerDepth.size() <= depth)
+        {
+            stats.nbNodesPerDepth.resize(depth + 1);
+            stats.nbValuesPerDepth.resize(depth + 1);
+        }
+        ++stats.nbNodesPerDepth[depth];
+        stats.nbValuesPerDepth[depth] += nbValues;
+        if (stats.nbNodesPerValueCount.size() <= nbValues)
+            stats.nbNodesPerValueCount.resize(nbValues + 1);
+        ++stats.nbNodesPerValueCount[nbValues];
+        if (isLeaf(node))
+            ++stats.nbLeaves;
+        else
+        {
+            stats.nbValuesInInteriorNodes += nbValues;
+            for (auto i = std::size_t(0); i < NbChildren; ++i)
+                computeStats(mNodes.getChild(node, i), depth + 1, stats);
+        }
+    }
+
+    // Call visitor with args and return false if the traversal must stop
+    template<typename Visitor, typename... Args>
+    static bool visit(Visitor& visitor, const Args&... args)
+    {
+        if constexpr (std::is_same_v<std::invoke_result_t<Visitor&, const Args&...>, bool>)
+            return visitor(args...);
+        else
+        {
+            visitor(args...);
+            return true;
+        }
+    }
+};
+
+}
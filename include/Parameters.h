@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+namespace quadtree
+{
+
+// Parameters controlling the shape of the tree: a leaf is split when it has
+// more than threshold values and nodes are not split beyond maxDepth
+// getMaxDepthBound() is a compile-time bound of maxDepth used to size the
+// stacks of the traversals
+
+// Largest maxDepth supported by DynamicParameters
+constexpr auto MaxSupportedDepth = std::size_t(32);
+
+// Parameters known at compile time
+template<std::size_t Threshold = 16, std::size_t MaxDepth = 8>
+struct StaticParameters
+{
+    static_assert(Threshold > 0, "Threshold must be positive");
+    static_assert(MaxDepth <= MaxSupportedDepth, "MaxDepth is too large");
+
+    static constexpr std::size_t getThreshold() noexcept
+    {
+        return Threshold;
+    }
+
+    static constexpr std::size_t getMaxDepth() noexcept
+    {
+        return MaxDepth;
+    }
+
+    static constexpr std::size_t getMaxDepthBound() noexcept
+    {
+        return MaxDepth;
+    }
+};
+
+// Parameters chosen at runtime, maxDepth is clamped to MaxSupportedDepth as
+// the traversal stacks can not hold deeper trees
+class DynamicParameters
+{
+public:
+    constexpr DynamicParameters(std::size_t threshold = 16, std::size_t maxDepth = 8) noexcept :
+        mThreshold(threshold), mMaxDepth(std::min(maxDepth, MaxSupportedDepth))
+    {
+        assert(mThreshold > 0 && "Threshold must be positive");
+    }
+
+    constexpr std::size_t getThreshold() const noexcept
+    {
+        return mThreshold;
+    }
+
+    constexpr std::size_t getMaxDepth() const noexcept
+    {
+        return mMaxDepth;
+    }
+
+    static constexpr std::size_t getMaxDepthBound() noexcept
+    {
+        return MaxSupportedDepth;
+    }
+
+private:
+    std::size_t mThreshold;
+    std::size_t mMaxDepth;
+};
+
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cassert>
+#include <type_traits>
+#include <utility>
+#include "Bounds.h"
+
+namespace quadtree
+{
+
+// Quadrants are numbered in Z-order: 0 is North West, 1 is North East, 2 is
+// South West and 3 is South East
+
+// Size of the west and north quadrants, integer sizes are halved with a
+// shift and the east and south quadrants take the remainder so that the
+// quadrants tile their parent exactly
+template<typename Float>
+constexpr Float halve(Float size) noexcept
+{
+    if constexpr (std::is_integral_v<Float>)
+    {
+        size >>= 1;
+        return size;
+    }
+    else
+        return size / static_cast<Float>(2);
+}
+
+// Box of the i-th quadrant of box
+template<typename Float>
+Box<Float> computeBox(const Box<Float>& box, int i)
+{
+    auto origin = box.getTopLeft();
+    auto childSize = Vector2<Float>(halve(box.width), halve(box.height));
+    // Equal to childSize for floating point sizes
+    auto remainingSize = Vector2<Float>(box.width - childSize.x, box.height - childSize.y);
+    switch (i)
+    {
+        // North West
+        case 0:
+            return Box<Float>(origin, childSize);
+        // Norst East
+        case 1:
+            return Box<Float>(Vector2<Float>(origin.x + childSize.x, origin.y),
+                Vector2<Float>(remainingSize.x, childSize.y));
+        // South West
+        case 2:
+            return Box<Float>(Vector2<Float>(origin.x, origin.y + childSize.y),
+                Vector2<Float>(childSize.x, remainingSize.y));
+        // South East
+        case 3:
+            return Box<Float>(origin + childSize, remainingSize);
+        default:
+            assert(false && "Invalid child index");
+            return Box<Float>();
+    }
+}
+
+// Quadrant of nodeBox entirely containing valueBounds or -1 if there is none
+template<typename Float>
+int getQuadrant(const Box<Float>& nodeBox, const Bounds<Float>& valueBounds)
+{
+    // Integer coordinates are exact, a value ending on the center line is
+    // contained in the west or north quadrant and the quadrant is assembled
+    // from the comparisons without branches
+    if constexpr (std::is_integral_v<Float>)
+    {
+        auto centerX = nodeBox.left + halve(nodeBox.width);
+        auto centerY = nodeBox.top + halve(nodeBox.height);
+        auto west = valueBounds.right <= centerX;
+        auto east = valueBounds.left >= centerX;
+        auto north = valueBounds.bottom <= centerY;
+        auto south = valueBounds.top >= centerY;
+        auto i = static_cast<int>(east) | (static_cast<int>(south) << 1);
+        return ((west | east) & (north | south)) ? i : -1;
+    }
+    else
+    {
+        auto center = nodeBox.getCenter();
+        // West
+        if (valueBounds.right < center.x)
+        {
+            // North West
+            if (valueBounds.bottom < center.y)
+                return 0;
+            // South West
+            else if (valueBounds.top >= center.y)
+                return 2;
+            // Not contained in any quadrant
+            else
+                return -1;
+        }
+        // East
+        else if (valueBounds.left >= center.x)
+        {
+            // North East
+            if (valueBounds.bottom < center.y)
+                return 1;
+            // South East
+            else if (valueBounds.top >= center.y)
+                return 3;
+            // Not contained in any quadrant
+            else
+                return -1;
+        }
+        // Not contained in any quadrant
+        else
+            return -1;
+    }
+}
+
+// Children of boxes of any dimension are numbered so that bit a of the index
+// is set if the child is in the upper half along axis a, it is the same
+// numbering as above in dimension 2
+
+// Call f(std::integral_constant<std::size_t, axis>()) for each axis, the
+// loop is unrolled at compile time
+template<typename F, std::size_t... Axes>
+constexpr void forEachAxis(F&& f, std::index_sequence<Axes...>)
+{
+    (f(std::integral_constant<std::size_t, Axes>()), ...);
+}
+
+template<std::size_t D, typename F>
+constexpr void forEachAxis(F&& f)
+{
+    forEachAxis(std::forward<F>(f), std::make_index_sequence<D>());
+}
+
+// Box of the i-th child of box
+template<typename Float, std::size_t D>
+Box<Float, D> computeBox(const Box<Float, D>& box, int i)
+{
+    assert(i >= 0 && i < (1 << D) && "Invalid child index");
+    auto position = box.getPosition();
+    auto size = box.getSize();
+    forEachAxis<D>([&position, &size, i](auto axis)
+    {
+        auto childSize = halve(size[axis]);
+        if ((i >> axis) & 1)
+        {
+            position[axis] += childSize;
+            size[axis] -= childSize;
+        }
+        else
+            size[axis] = childSize;
+    });
+    return Box<Float, D>(position, size);
+}
+
+// Child of nodeBox entirely containing valueBounds or -1 if there is none
+template<typename Float, std::size_t D>
+int getQuadrant(const Box<Float, D>& nodeBox, const Bounds<Float, D>& valueBounds)
+{
+    auto nodePosition = nodeBox.getPosition();
+    auto nodeSize = nodeBox.getSize();
+    auto valueLower = valueBounds.getLower();
+    auto valueUpper = valueBounds.getUpper();
+    auto i = 0;
+    auto contained = true;
+    forEachAxis<D>([&](auto axis)
+    {
+        auto center = nodePosition[axis] + halve(nodeSize[axis]);
+        // Same comparisons as getQuadrant in dimension 2
+        auto lower = std::is_integral_v<Float> ? valueUpper[axis] <= center : valueUpper[axis] < center;
+        auto upper = valueLower[axis] >= center;
+        contained = contained && (lower || upper);
+        i |= static_cast<int>(upper) << axis;
+    });
+    return contained ? i : -1;
+}
+
+}
@@ -3,17 +3,62 @@
 #include <cassert>
 #include <algorithm>
 #include <array>
+#include <cstdint>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
 #include <type_traits>
+#include <utility>
 #include <vector>
 #include "Box.h"
+#include "HandleTable.h"
+#include "Morton.h"
+#include "NodeStorage.h"
+#include "OrthtreeBase.h"
+#include "Parameters.h"
+#include "Quadrant.h"
+#include "Simd.h"
+#include "Snapshot.h"
+#include "Stats.h"
+#include "ThreadPool.h"
+#include "TraversalStack.h"
+#include "ValueStorage.h"
 
 namespace quadtree
 {
 
-template<typename T, typename GetBox, typename Equal = std::equal_to<T>, typename Float = float>
-class Quadtree
+template<typename T, typename GetBox, typename Equal, typename Float, typename Storage, bool CacheBoxes,
+    typename Parameters, typename Allocator, bool Handles>
+class Quadtree;
+
+// Type of the values of Tree if it is a Quadtree whose coordinates are of type
+// Float, used to constrain the joins
+template<typename Tree, typename Float>
+struct QuadtreeValue
+{
+
+};
+
+template<typename T, typename GetBox, typename Equal, typename Float, typename Storage, bool CacheBoxes,
+    typename Parameters, typename Allocator, bool Handles>
+struct QuadtreeValue<Quadtree<T, GetBox, Equal, Float, Storage, CacheBoxes, Parameters, Allocator, Handles>, Float>
+{
+    using type = T;
+};
+
+template<typename Tree, typename Float>
+using QuadtreeValueT = typename QuadtreeValue<Tree, Float>::type;
+
+template<typename T, typename GetBox, typename Equal = std::equal_to<T>, typename Float = float,
+    typename Storage = PointerStorage, bool CacheBoxes = false, typename Parameters = StaticParameters<>,
+    typename Allocator = std::allocator<T>, bool Handles = false>
+class Quadtree : public OrthtreeBase<T, GetBox, 2, Equal, Float, Storage, CacheBoxes, Parameters, Allocator, Handles>
 {
+    using Base = OrthtreeBase<T, GetBox, 2, Equal, Float, Storage, CacheBoxes, Parameters, Allocator, Handles>;
+
     static_assert(std::is_convertible_v<std::invoke_result_t<GetBox, const T&>, Box<Float>>,
         "GetBox must be a callable of signature Box<Float>(const T&)");
     static_assert(std::is_convertible_v<std::invoke_result_t<Equal, const T&, const T&>, bool>,
@@ -21,294 +66,1178 @@ class Quadtree
     static_assert(std::is_arithmetic_v<Float>);
 
 public:
+    // Results of a batch of queries, the buffers are reused between batches
+    class QueryBatchResult
+    {
+    public:
+        std::size_t size() const
+        {
+            return mOffsets.empty() ? 0 : mOffsets.size() - 1;
+        }
+
+        // Values intersecting the i-th box of the batch
+        const T* begin(std::size_t i) const
+        {
+            return mValues.data() + mOffsets[i];
+        }
+
+        const T* end(std::size_t i) const
+        {
+            return mValues.data() + mOffsets[i + 1];
+        }
+
+        // The values intersecting the i-th box are values[offsets[i]] to values[offsets[i + 1] - 1]
+        const std::vector<std::size_t>& getOffsets() const
+        {
+            return mOffsets;
+        }
+
+        const std::vector<T>& getValues() const
+        {
+            return mValues;
+        }
+
+    private:
+        friend class Quadtree;
+
+        std::vector<std::size_t> mOffsets;
+        std::vector<T> mValues;
+        std::vector<std::pair<std::uint64_t, std::size_t>> mOrder; // Morton code and index of the boxes
+        std::vector<std::vector<T>> mChunks; // Values found by each task
+    };
+
+    // The nodes and the values are allocated with allocator
     Quadtree(const Box<Float>& box, const GetBox& getBox = GetBox(),
-        const Equal& equal = Equal()) :
-        mBox(box), mRoot(std::make_unique<Node>()), mGetBox(getBox), mEqual(equal)
+        const Equal& equal = Equal(), const Parameters& parameters = Parameters(),
+        const Allocator& allocator = Allocator()) :
+        Base(box, getBox, equal, parameters, allocator)
     {
 
     }
 
-    void add(const T& value)
+    // Build the tree from the values in [first, last), the values are
+    // partitioned top-down by quadrant and each node is filled at once
+    template<typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+    Quadtree(const Box<Float>& box, InputIt first, InputIt last, const GetBox& getBox = GetBox(),
+        const Equal& equal = Equal(), const Parameters& parameters = Parameters(),
+        const Allocator& allocator = Allocator()) :
+        Quadtree(box, getBox, equal, parameters, allocator)
     {
-        add(mRoot.get(), 0, mBox, value);
+        static_assert(!Handles, "Bulk loading does not create handles");
+        auto entries = createEntries(first, last);
+        auto allocate = [](auto&& allocation){ return allocation(); };
+        auto spawn = [](std::size_t worker, std::size_t, auto&& task){ task(worker); };
+        auto quadrants = std::vector<std::int8_t>(entries.size());
+        build(mNodes.getRoot(), 0, mBox, entries.data(), entries.data() + entries.size(), quadrants.data(),
+            allocate, spawn, 0);
+    }
+
+    // Same as above but the subtrees are built in parallel by the threads of pool
+    template<typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+    Quadtree(const Box<Float>& box, InputIt first, InputIt last, ThreadPool& pool, const GetBox& getBox = GetBox(),
+        const Equal& equal = Equal(), const Parameters& parameters = Parameters(),
+        const Allocator& allocator = Allocator()) :
+        Quadtree(box, getBox, equal, parameters, allocator)
+    {
+        static_assert(!Handles, "Bulk loading does not create handles");
+        auto entries = createEntries(first, last);
+        // The node storage and the allocator are shared by all the tasks, the
+        // allocator may not be thread-safe, e.g. std::pmr::unsynchronized_pool_resource
+        auto mutex = std::mutex();
+        auto allocate = [&mutex](auto&& allocation)
+        {
+            auto lock = std::lock_guard(mutex);
+            return allocation();
+        };
+        auto spawn = [&pool](std::size_t worker, std::size_t depth, auto&& task)
+        {
+            // Small subtrees are built by a single task
+            if (depth < ParallelMaxDepth)
+                pool.spawn(worker, std::forward<decltype(task)>(task));
+            else
+                task(worker);
+        };
+        auto quadrants = std::vector<std::int8_t>(entries.size());
+        pool.run([this, &entries, &quadrants, &allocate, &spawn](std::size_t worker)
+        {
+            build(mNodes.getRoot(), 0, mBox, entries.data(), entries.data() + entries.size(), quadrants.data(),
+                allocate, spawn, worker);
+        });
+    }
+
+    // Return the handle of the value if Handles is true
+    auto add(const T& value)
+    {
+        assert(mBox.contains(mGetBox(value)));
+        if constexpr (Handles)
+        {
+            auto handle = mHandles.create();
+            add(mNodes.getRoot(), 0, mBox, value, Bounds<Float>::fromBox(mGetBox(value)), handle.index);
+            return handle;
+        }
+        else
+            add(mNodes.getRoot(), 0, mBox, value, Bounds<Float>::fromBox(mGetBox(value)), 0);
     }
 
     void remove(const T& value)
     {
-        remove(mRoot.get(), mBox, value);
+        assert(mBox.contains(mGetBox(value)));
+        auto handle = std::uint32_t(0);
+        auto find = [this, &value, &handle](const Node* node)
+        {
+            auto i = findValue(node, value);
+            handle = getHandle(node->values, i);
+            return i;
+        };
+        remove(mNodes.getRoot(), mBox, Bounds<Float>::fromBox(mGetBox(value)), find);
+        if constexpr (Handles)
+            mHandles.destroy(handle);
+    }
+
+    // Remove the value of handle without searching it in its node, the box of
+    // the value must not have changed since it was added or updated
+    void remove(Handle handle)
+    {
+        static_assert(Handles, "Handles must be enabled");
+        auto [node, i] = getLocation(handle);
+        auto find = KnownLocation{node, i};
+        remove(mNodes.getRoot(), mBox, node->values.getBounds(i, mGetBox), find);
+        mHandles.destroy(handle);
+    }
+
+    // Move value from oldBox to its current box, only the nodes below the
+    // last node containing both boxes are modified and nothing is done if the
+    // value stays in the same node
+    void update(const T& value, const Box<Float>& oldBox)
+    {
+        assert(mBox.contains(oldBox));
+        assert(mBox.contains(mGetBox(value)));
+        auto find = [this, &value](const Node* node)
+        {
+            return findValue(node, value);
+        };
+        update(mNodes.getRoot(), 0, mBox, value, Bounds<Float>::fromBox(oldBox),
+            Bounds<Float>::fromBox(mGetBox(value)), find);
+    }
+
+    // Same as above but the value is not searched in its node
+    void update(Handle handle, const Box<Float>& oldBox)
+    {
+        static_assert(Handles, "Handles must be enabled");
+        assert(mBox.contains(oldBox));
+        auto [node, i] = getLocation(handle);
+        auto value = node->values[i];
+        assert(mBox.contains(mGetBox(value)));
+        auto find = KnownLocation{node, i};
+        update(mNodes.getRoot(), 0, mBox, value, Bounds<Float>::fromBox(oldBox),
+            Bounds<Float>::fromBox(mGetBox(value)), find);
+    }
+
+    // Same as above but the old box is the one cached in the tree
+    void update(Handle handle)
+    {
+        static_assert(Handles && CacheBoxes, "Handles must be enabled and boxes must be cached");
+        auto [node, i] = getLocation(handle);
+        auto value = node->values[i];
+        assert(mBox.contains(mGetBox(value)));
+        auto find = KnownLocation{node, i};
+        update(mNodes.getRoot(), 0, mBox, value, node->values.getBounds(i, mGetBox),
+            Bounds<Float>::fromBox(mGetBox(value)), find);
+    }
+
+    const T& getValue(Handle handle) const
+    {
+        static_assert(Handles, "Handles must be enabled");
+        const auto& location = mHandles.get(handle);
+        const auto node = location.node != nullptr ? location.node : mNodes.getRoot();
+        return node->values[location.position];
+    }
+
+    // Return false if the value of handle has been removed
+    bool isValid(Handle handle) const
+    {
+        static_assert(Handles, "Handles must be enabled");
+        return mHandles.isValid(handle);
     }
 
     std::vector<T> query(const Box<Float>& box) const
     {
         auto values = std::vector<T>();
-        query(mRoot.get(), mBox, box, values);
+        query(box, std::back_inserter(values));
         return values;
     }
 
+    // Call visitor(value) for each value intersecting box, if visitor returns
+    // a bool, the query stops as soon as it returns false
+    // Return false if the query has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&>, bool> query(const Box<Float>& box, Visitor&& visitor) const
+    {
+        return query(mNodes.getRoot(), mBox, Bounds<Float>::fromBox(box), visitor);
+    }
+
+    // Write the values intersecting box in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&>, OutputIt> query(const Box<Float>& box, OutputIt out) const
+    {
+        query(box, [&out](const T& value){ *out++ = value; });
+        return out;
+    }
+
     std::vector<std::pair<T, T>> findAllIntersections() const
     {
         auto intersections = std::vector<std::pair<T, T>>();
-        findAllIntersections(mRoot.get(), intersections);
+        findAllIntersections(std::back_inserter(intersections));
+        return intersections;
+    }
+
+    // Call visitor(value1, value2) for each pair of intersecting values, if
+    // visitor returns a bool, the search stops as soon as it returns false
+    // Return false if the search has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&, const T&>, bool> findAllIntersections(Visitor&& visitor) const
+    {
+        return findAllIntersections(mNodes.getRoot(), visitor);
+    }
+
+    // Write the pairs of intersecting values in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&, const T&>, OutputIt> findAllIntersections(OutputIt out) const
+    {
+        findAllIntersections([&out](const T& value1, const T& value2){ *out++ = std::pair<T, T>(value1, value2); });
+        return out;
+    }
+
+    std::vector<T> findIntersections(const T& value) const
+    {
+        auto values = std::vector<T>();
+        findIntersections(value, std::back_inserter(values));
+        return values;
+    }
+
+    // Call visitor(other) for each value other than value intersecting it, if
+    // visitor returns a bool, the search stops as soon as it returns false
+    // Only the nodes on the path to value and the descendants of its node are visited
+    // Return false if the search has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&>, bool> findIntersections(const T& value, Visitor&& visitor) const
+    {
+        // The value itself is skipped
+        auto otherVisitor = [this, &visitor](const T& value1, const T& value2)
+        {
+            return mEqual(value1, value2) || visit(visitor, value2);
+        };
+        return findIntersections(mNodes.getRoot(), mBox, value, Bounds<Float>::fromBox(mGetBox(value)), otherVisitor);
+    }
+
+    // Write the values intersecting value in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&>, OutputIt> findIntersections(const T& value, OutputIt out) const
+    {
+        findIntersections(value, [&out](const T& other){ *out++ = other; });
+        return out;
+    }
+
+    // Return the pairs of a value of this tree and a value of other that
+    // intersect, the trees can have different boxes, depths, values, boxes
+    // getters and storages but their coordinates must be of the same type
+    template<typename OtherQuadtree, typename U = QuadtreeValueT<OtherQuadtree, Float>>
+    std::vector<std::pair<T, U>> findIntersections(const OtherQuadtree& other) const
+    {
+        auto intersections = std::vector<std::pair<T, U>>();
+        findIntersections(other, std::back_inserter(intersections));
+        return intersections;
+    }
+
+    // Call visitor(value1, value2) for each value1 of this tree intersecting
+    // a value2 of other, if visitor returns a bool, the search stops as soon
+    // as it returns false
+    // Both trees are traversed at once and pairs of disjoint nodes are skipped
+    // Return false if the search has been stopped, true otherwise
+    template<typename OtherQuadtree, typename Visitor, typename U = QuadtreeValueT<OtherQuadtree, Float>>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&, const U&>, bool> findIntersections(
+        const OtherQuadtree& other, Visitor&& visitor) const
+    {
+        if (!Bounds<Float>::fromBox(mBox).intersects(Bounds<Float>::fromBox(other.mBox)))
+            return true;
+        return findIntersections(mNodes.getRoot(), mBox, other, other.mNodes.getRoot(), other.mBox, visitor);
+    }
+
+    // Write the pairs of intersecting values of this tree and of other in out
+    template<typename OtherQuadtree, typename OutputIt, typename U = QuadtreeValueT<OtherQuadtree, Float>>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&, const U&>, OutputIt> findIntersections(
+        const OtherQuadtree& other, OutputIt out) const
+    {
+        findIntersections(other, [&out](const T& value1, const U& value2)
+        {
+            *out++ = std::pair<T, U>(value1, value2);
+        });
+        return out;
+    }
+
+    // Return the k values nearest to point sorted by increasing distance,
+    // the distance of a value is the distance to its box and values farther
+    // than maxDistance are ignored
+    std::vector<T> findNearest(const Vector2<Float>& point, std::size_t k,
+        Float maxDistance = std::numeric_limits<Float>::max()) const
+    {
+        // Squared distances are compared so that there is no square root and
+        // that the distances are exact for integer coordinates
+        if (maxDistance < Float(0))
+            return {};
+        auto max = std::numeric_limits<Float>::max();
+        auto squaredMaxDistance = maxDistance == Float(0) || maxDistance <= max / maxDistance ?
+            maxDistance * maxDistance : max;
+        return findNearest(mNodes.getRoot(), k, squaredMaxDistance,
+            [this, &point](const Node* node, std::size_t i)
+            {
+                return node->values.getBounds(i, mGetBox).getSquaredDistance(point);
+            },
+            [&point](const Bounds<Float>& bounds){ return bounds.getSquaredDistance(point); });
+    }
+
+    // Same as above but the distance of a value is distance(value, point), it
+    // must not be smaller than the distance from point to the box of value
+    template<typename Distance>
+    std::vector<T> findNearest(const Vector2<Float>& point, std::size_t k, Float maxDistance,
+        const Distance& distance) const
+    {
+        static_assert(std::is_convertible_v<std::invoke_result_t<const Distance&, const T&, const Vector2<Float>&>, Float>,
+            "Distance must be a callable of signature Float(const T&, const Vector2<Float>&)");
+        return findNearest(mNodes.getRoot(), k, maxDistance,
+            [&distance, &point](const Node* node, std::size_t i){ return distance(node->values[i], point); },
+            [&point](const Bounds<Float>& bounds){ return bounds.getDistance(point); });
+    }
+
+    // Return the first value whose box is hit by the ray origin + t * direction
+    // with t in [0, maxT]
+    std::optional<T> raycast(const Vector2<Float>& origin, const Vector2<Float>& direction,
+        Float maxT = std::numeric_limits<Float>::max()) const
+    {
+        auto hit = std::optional<T>();
+        raycast(origin, direction, maxT, [&hit](const T& value, Float){ hit = value; return true; });
+        return hit;
+    }
+
+    // Call visitor(value, t) by increasing t for each value whose box is hit by
+    // the ray origin + t * direction with t in [0, maxT], the cast stops as
+    // soon as visitor returns true to accept the hit
+    // Return true if a hit has been accepted, false otherwise
+    template<typename Visitor>
+    bool raycast(const Vector2<Float>& origin, const Vector2<Float>& direction, Float maxT, Visitor&& visitor) const
+    {
+        static_assert(std::is_convertible_v<std::invoke_result_t<Visitor&, const T&, Float>, bool>,
+            "Visitor must be a callable of signature bool(const T&, Float)");
+        return raycast(mNodes.getRoot(), origin, direction, maxT, visitor);
+    }
+
+    // Same pairs as findAllIntersections() but subtrees and large nodes are
+    // processed in parallel by the threads of pool
+    std::vector<std::pair<T, T>> findAllIntersections(ThreadPool& pool) const
+    {
+        // Each worker writes in its own buffer
+        auto buffers = std::vector<std::vector<std::pair<T, T>>>(pool.getNbThreads());
+        pool.run([this, &pool, &buffers](std::size_t worker)
+        {
+            findAllIntersections(pool, mNodes.getRoot(), 0, buffers, worker);
+        });
+        // Merge the buffers
+        auto size = std::size_t(0);
+        for (const auto& buffer : buffers)
+            size += buffer.size();
+        auto intersections = std::vector<std::pair<T, T>>();
+        intersections.reserve(size);
+        for (const auto& buffer : buffers)
+            intersections.insert(std::end(intersections), std::begin(buffer), std::end(buffer));
         return intersections;
     }
 
-    Box<Float> getBox() const 
+    // Query all the boxes in parallel, the boxes are sorted along a Z-order
+    // curve so that a task processes boxes that are close to each other
+    void queryBatch(const Box<Float>* boxes, std::size_t nbBoxes, ThreadPool& pool, QueryBatchResult& result) const
+    {
+        // Sort the boxes by the Morton code of their center
+        result.mOrder.resize(nbBoxes);
+        for (auto i = std::size_t(0); i < nbBoxes; ++i)
+            result.mOrder[i] = std::make_pair(computeMortonCode(mBox, boxes[i].getCenter(), BatchMortonDepth), i);
+        std::sort(std::begin(result.mOrder), std::end(result.mOrder));
+        // Each task processes a contiguous range of sorted boxes and writes in its own buffer
+        auto nbChunks = std::min(nbBoxes, pool.getNbThreads() * BatchChunksPerThread);
+        auto chunkSize = nbChunks > 0 ? (nbBoxes + nbChunks - 1) / nbChunks : 0;
+        result.mChunks.resize(nbChunks);
+        result.mOffsets.resize(nbBoxes + 1);
+        result.mOffsets[0] = 0;
+        auto queryChunk = [this, boxes, nbBoxes, chunkSize, &result](std::size_t chunk)
+        {
+            auto& values = result.mChunks[chunk];
+            values.clear();
+            for (auto i = chunk * chunkSize; i < std::min((chunk + 1) * chunkSize, nbBoxes); ++i)
+            {
+                auto j = result.mOrder[i].second;
+                auto size = values.size();
+                query(boxes[j], [&values](const T& value){ values.push_back(value); });
+                result.mOffsets[j + 1] = values.size() - size;
+            }
+        };
+        pool.run([&pool, nbChunks, &queryChunk](std::size_t worker)
+        {
+            for (auto chunk = std::size_t(0); chunk < nbChunks; ++chunk)
+                pool.spawn(worker, [&queryChunk, chunk](std::size_t){ queryChunk(chunk); });
+        });
+        // Compute the offsets
+        for (auto i = std::size_t(0); i < nbBoxes; ++i)
+            result.mOffsets[i + 1] += result.mOffsets[i];
+        // Copy the values of each task at their place
+        result.mValues.resize(result.mOffsets[nbBoxes]);
+        auto copyChunk = [nbBoxes, chunkSize, &result](std::size_t chunk)
+        {
+            auto it = std::begin(result.mChunks[chunk]);
+            for (auto i = chunk * chunkSize; i < std::min((chunk + 1) * chunkSize, nbBoxes); ++i)
+            {
+                auto j = result.mOrder[i].second;
+                auto size = static_cast<std::ptrdiff_t>(result.mOffsets[j + 1] - result.mOffsets[j]);
+                std::copy(it, it + size, std::begin(result.mValues) + static_cast<std::ptrdiff_t>(result.mOffsets[j]));
+                it += size;
+            }
+        };
+        pool.run([&pool, nbChunks, &copyChunk](std::size_t worker)
+        {
+            for (auto chunk = std::size_t(0); chunk < nbChunks; ++chunk)
+                pool.spawn(worker, [&copyChunk, chunk](std::size_t){ copyChunk(chunk); });
+        });
+    }
+
+    void queryBatch(const std::vector<Box<Float>>& boxes, ThreadPool& pool, QueryBatchResult& result) const
     {
-        return mBox;
+        queryBatch(boxes.data(), boxes.size(), pool, result);
     }
-    
+
+    // Write a snapshot of the tree that can be loaded without copy by a
+    // SnapshotQuadtree, T must be trivially copyable
+    void writeSnapshot(std::ostream& out) const
+    {
+        auto buffers = SnapshotBuffers<T, Float>();
+        buildSnapshot(buffers);
+        quadtree::writeSnapshot(out, buffers);
+    }
+
+    // Flatten the tree in buffers that can be read by a SnapshotQuadtree, the
+    // previous content of buffers is replaced but their capacity is reused so
+    // that rebuilding a snapshot of a tree of similar size does not allocate
+    void buildSnapshot(SnapshotBuffers<T, Float>& buffers) const
+    {
+        buffers.clear();
+        buffers.box = mBox;
+        buffers.nodes.emplace_back();
+        buildSnapshot(mNodes.getRoot(), 0, buffers);
+        assert(buffers.nodes.size() <= std::numeric_limits<std::uint32_t>::max() &&
+            buffers.values.size() <= std::numeric_limits<std::uint32_t>::max() && "Too many nodes or values");
+    }
+
 private:
-    static constexpr auto Threshold = std::size_t(16);
-    static constexpr auto MaxDepth = std::size_t(8);
+    static constexpr auto ParallelMaxDepth = std::size_t(4); // Deeper subtrees are processed by a single task
+    static constexpr auto ParallelMinValues = std::size_t(64); // Smaller nodes are tested against descendants by a single task
+    static constexpr auto BatchChunksPerThread = std::size_t(8); // More chunks than threads to balance the work
+    static constexpr auto BatchMortonDepth = std::size_t(16);
+    // Nodes with fewer values are tested pair by pair, larger ones are swept
+    // along x, the crossovers come from quadtreeClusterFindAllIntersections
+    static constexpr auto SweepMinValues = CacheBoxes ? std::size_t(32) : std::size_t(16);
 
-    struct Node
+    // Visitor used to collect pairs in a vector
+    struct PairInserter
     {
-        std::array<std::unique_ptr<Node>, 4> children;
-        std::vector<T> values;
+        std::vector<std::pair<T, T>>& intersections;
+
+        void operator()(const T& value1, const T& value2)
+        {
+            intersections.emplace_back(value1, value2);
+        }
     };
 
-    Box<Float> mBox;
-    std::unique_ptr<Node> mRoot;
-    GetBox mGetBox;
-    Equal mEqual;
+    using Entry = std::pair<T, Bounds<Float>>;
 
-    bool isLeaf(const Node* node) const
+    // Value with its bounds, sorted by left side for the sweeps
+    struct SweepEntry
     {
-        return !static_cast<bool>(node->children[0]);
+        Bounds<Float> bounds;
+        const T* value;
+    };
+
+    // Buffers of the sweeps, reused by all the nodes of a traversal
+    struct SweepBuffers
+    {
+        std::vector<SweepEntry> values; // Values of the current node
+        std::vector<SweepEntry> descendants; // Values of a subtree
+    };
+
+    // The joins access the nodes of the other trees
+    template<typename, typename, typename, typename, typename, bool, typename, typename, bool>
+    friend class Quadtree;
+
+    using typename Base::Values;
+    using typename Base::Node;
+    using typename Base::KnownLocation;
+
+    using Base::mBox;
+    using Base::mNodes;
+    using Base::mGetBox;
+    using Base::mEqual;
+    using Base::mParameters;
+    using Base::mHandles;
+    using Base::mCounters;
+
+    using Base::isLeaf;
+    using Base::getChildren;
+    using Base::add;
+    using Base::remove;
+    using Base::update;
+    using Base::findValue;
+    using Base::getHandle;
+    using Base::getLocation;
+    using Base::visit;
+
+    template<typename InputIt>
+    std::vector<Entry> createEntries(InputIt first, InputIt last) const
+    {
+        auto entries = std::vector<Entry>();
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>)
+            entries.reserve(static_cast<std::size_t>(std::distance(first, last)));
+        for (; first != last; ++first)
+        {
+            assert(mBox.contains(mGetBox(*first)));
+            entries.emplace_back(*first, Bounds<Float>::fromBox(mGetBox(*first)));
+        }
+        return entries;
     }
 
-    Box<Float> computeBox(const Box<Float>& box, int i) const
+    // quadrants is a buffer of the same size as [first, last),
+    // allocate(allocation) must call allocation() and return its result, all
+    // the allocations of the build and the accesses to the node storage go
+    // through it as the values are pushed in reserved storage, and
+    // spawn(worker, depth, task) must execute task(worker) at some point
+    template<typename Allocate, typename Spawn>
+    void build(Node* node, std::size_t depth, const Box<Float>& box, Entry* first, Entry* last,
+        std::int8_t* quadrants, Allocate& allocate, Spawn& spawn, std::size_t worker)
     {
-        auto origin = box.getTopLeft();
-        auto childSize = box.getSize() / static_cast<Float>(2);
-        switch (i)
+        assert(node != nullptr);
+        // Put all the values in this node if it does not need to be split
+        if (depth >= mParameters.getMaxDepth() || static_cast<std::size_t>(last - first) <= mParameters.getThreshold())
         {
-            // North West
-            case 0:
-                return Box<Float>(origin, childSize);
-            // Norst East
-            case 1:
-                return Box<Float>(Vector2<Float>(origin.x + childSize.x, origin.y), childSize);
-            // South West
-            case 2:
-                return Box<Float>(Vector2<Float>(origin.x, origin.y + childSize.y), childSize);
-            // South East
-            case 3:
-                return Box<Float>(origin + childSize, childSize);
-            default:
-                assert(false && "Invalid child index");
-                return Box<Float>();
+            allocate([node, n = static_cast<std::size_t>(last - first)](){ node->values.reserve(n); });
+            for (auto it = first; it != last; ++it)
+                node->values.push_back(it->first, it->second);
+            return;
+        }
+        // Partition the values: first the ones not contained in any quadrant then the ones of each quadrant,
+        // the quadrant of each value is computed once and stored in quadrants
+        auto n = static_cast<std::size_t>(last - first);
+        auto counts = std::array<std::size_t, 5>();
+        for (auto i = std::size_t(0); i < n; ++i)
+        {
+            quadrants[i] = static_cast<std::int8_t>(getQuadrant(box, first[i].second) + 1);
+            ++counts[static_cast<std::size_t>(quadrants[i])];
+        }
+        auto ranges = std::array<std::size_t, 6>();
+        for (auto i = std::size_t(0); i < 5; ++i)
+            ranges[i + 1] = ranges[i] + counts[i];
+        auto next = ranges;
+        for (auto i = std::size_t(0); i < 5; ++i)
+        {
+            // Swap the values until the range of quadrant i only contains values of quadrant i
+            while (next[i] < ranges[i + 1])
+            {
+                auto j = static_cast<std::size_t>(quadrants[next[i]]);
+                if (j == i)
+                    ++next[i];
+                else
+                {
+                    std::swap(first[next[i]], first[next[j]]);
+                    std::swap(quadrants[next[i]], quadrants[next[j]]);
+                    ++next[j];
+                }
+            }
+        }
+        // Values not contained in any quadrant stay in this node
+        // The children are fetched while allocating as another task may grow
+        // the node storage concurrently
+        auto children = allocate([this, node, n = ranges[1]]()
+        {
+            node->values.reserve(n);
+            mCounters.addAllocation();
+            mNodes.createChildren(node);
+            return getChildren(node);
+        });
+        for (auto i = std::size_t(0); i < ranges[1]; ++i)
+            node->values.push_back(first[i].first, first[i].second);
+        // Build the children
+        for (auto i = std::size_t(0); i < 4; ++i)
+        {
+            spawn(worker, depth, [this, depth, &allocate, &spawn, child = children[i],
+                childBox = computeBox(box, static_cast<int>(i)), childFirst = first + ranges[i + 1],
+                childLast = first + ranges[i + 2], childQuadrants = quadrants + ranges[i + 1]](std::size_t thief)
+            {
+                build(child, depth + 1, childBox, childFirst, childLast, childQuadrants, allocate, spawn, thief);
+            });
         }
     }
 
-    int getQuadrant(const Box<Float>& nodeBox, const Box<Float>& valueBox) const
+    // Write node at index in buffers, its children are appended after the
+    // nodes already written
+    void buildSnapshot(const Node* node, std::size_t index, SnapshotBuffers<T, Float>& buffers) const
     {
-        auto center = nodeBox.getCenter();
-        // West
-        if (valueBox.getRight() < center.x)
+        auto& [box, nodes, values, lefts, tops, rights, bottoms] = buffers;
+        nodes[index] = SnapshotNode{0, static_cast<std::uint32_t>(values.size()),
+            static_cast<std::uint32_t>(node->values.size())};
+        for (auto i = std::size_t(0); i < node->values.size(); ++i)
         {
-            // North West
-            if (valueBox.getBottom() < center.y)
-                return 0;
-            // South West
-            else if (valueBox.top >= center.y)
-                return 2;
-            // Not contained in any quadrant
-            else
-                return -1;
-        }
-        // East
-        else if (valueBox.left >= center.x)
-        {
-            // North East
-            if (valueBox.getBottom() < center.y)
-                return 1;
-            // South East
-            else if (valueBox.top >= center.y)
-                return 3;
-            // Not contained in any quadrant
-            else
-                return -1;
+            auto bounds = node->values.getBounds(i, mGetBox);
+            values.push_back(node->values[i]);
+            lefts.push_back(bounds.left);
+            tops.push_back(bounds.top);
+            rights.push_back(bounds.right);
+            bottoms.push_back(bounds.bottom);
+        }
+        if (!isLeaf(node))
+        {
+            auto firstChild = nodes.size();
+            nodes[index].firstChild = static_cast<std::uint32_t>(firstChild);
+            nodes.resize(firstChild + 4);
+            for (auto i = std::size_t(0); i < 4; ++i)
+                buildSnapshot(mNodes.getChild(node, i), firstChild + i, buffers);
         }
-        // Not contained in any quadrant
-        else
-            return -1;
     }
 
-    void add(Node* node, std::size_t depth, const Box<Float>& box, const T& value)
+    // Call f(i) for each i in [first, last) such that values[i] intersects
+    // bounds, stop as soon as f returns false and return false in that case
+    template<typename F>
+    bool forEachIntersectingValue(const Values& values, std::size_t first, std::size_t last,
+        const Bounds<Float>& bounds, F&& f) const
     {
-        assert(node != nullptr);
-        assert(box.contains(mGetBox(value)));
-        if (isLeaf(node))
+        mCounters.addBoxesTested(last - first);
+        // Cached bounds are tested several at a time
+        if constexpr (CacheBoxes)
+            return forEachIntersectingBounds(bounds, values.getBoundsArrays(), first, last, std::forward<F>(f));
+        else
         {
-            // Insert the value in this node if possible
-            if (depth >= MaxDepth || node->values.size() < Threshold)
-                node->values.push_back(value);
-            // Otherwise, we split and we try again
-            else
+            for (auto i = first; i < last; ++i)
             {
-                split(node, box);
-                add(node, depth, box, value);
+                if (bounds.intersects(values.getBounds(i, mGetBox)) && !f(i))
+                    return false;
             }
+            return true;
         }
-        else
+    }
+
+    // The traversals are iterative and the children are pushed in reverse
+    // order so that the nodes are visited in the same order as recursively
+    template<typename Visitor>
+    bool query(const Node* root, const Box<Float>& rootBox, const Bounds<Float>& queryBounds, Visitor& visitor) const
+    {
+        // Box of the node in plain members so that the stack is not initialized
+        struct BoxedNode
         {
-            auto i = getQuadrant(box, mGetBox(value));
-            // Add the value in a child if the value is entirely contained in it
-            if (i != -1)
-                add(node->children[static_cast<std::size_t>(i)].get(), depth + 1, computeBox(box, i), value);
-            // Otherwise, we add the value in the current node
-            else
-                node->values.push_back(value);
+            const Node* node;
+            Float left;
+            Float top;
+            Float width;
+            Float height;
+        };
+        assert(root != nullptr);
+        assert(queryBounds.intersects(Bounds<Float>::fromBox(rootBox)));
+        auto stack = TraversalStack<BoxedNode, Parameters::getMaxDepthBound()>();
+        stack.push(BoxedNode{root, rootBox.left, rootBox.top, rootBox.width, rootBox.height});
+        while (!stack.empty())
+        {
+            auto entry = stack.pop();
+            auto node = entry.node;
+            mCounters.addNodesVisited(1);
+            if (!forEachIntersectingValue(node->values, 0, node->values.size(), queryBounds,
+                [&visitor, node](std::size_t i){ return visit(visitor, node->values[i]); }))
+                return false;
+            if (!isLeaf(node))
+            {
+                mCounters.addBoxesTested(4);
+                // Same boxes as computeBox(), a child intersects the query if
+                // both its column and its row do
+                auto childWidth = halve(entry.width);
+                auto childHeight = halve(entry.height);
+                auto eastWidth = entry.width - childWidth;
+                auto southHeight = entry.height - childHeight;
+                auto centerX = entry.left + childWidth;
+                auto centerY = entry.top + childHeight;
+                auto west = queryBounds.left < centerX && queryBounds.right > entry.left;
+                auto east = queryBounds.left < centerX + eastWidth && queryBounds.right > centerX;
+                auto north = queryBounds.top < centerY && queryBounds.bottom > entry.top;
+                auto south = queryBounds.top < centerY + southHeight && queryBounds.bottom > centerY;
+                stack.pushIf(BoxedNode{mNodes.getChild(node, 3), centerX, centerY, eastWidth, southHeight},
+                    south && east);
+                stack.pushIf(BoxedNode{mNodes.getChild(node, 2), entry.left, centerY, childWidth, southHeight},
+                    south && west);
+                stack.pushIf(BoxedNode{mNodes.getChild(node, 1), centerX, entry.top, eastWidth, childHeight},
+                    north && east);
+                stack.pushIf(BoxedNode{mNodes.getChild(node, 0), entry.left, entry.top, childWidth, childHeight},
+                    north && west);
+            }
         }
+        return true;
     }
 
-    void split(Node* node, const Box<Float>& box)
+    template<typename Visitor>
+    bool findAllIntersections(const Node* root, Visitor& visitor) const
     {
-        assert(node != nullptr);
-        assert(isLeaf(node) && "Only leaves can be split");
-        // Create children
-        for (auto& child : node->children)
-            child = std::make_unique<Node>();
-        // Assign values to children
-        auto newValues = std::vector<T>(); // New values for this node
-        for (const auto& value : node->values)
-        {
-            auto i = getQuadrant(box, mGetBox(value));
-            if (i != -1)
-                node->children[static_cast<std::size_t>(i)]->values.push_back(value);
-            else
-                newValues.push_back(value);
+        auto stack = TraversalStack<const Node*, Parameters::getMaxDepthBound()>();
+        auto buffers = SweepBuffers();
+        stack.push(root);
+        while (!stack.empty())
+        {
+            auto node = stack.pop();
+            mCounters.addNodesVisited(1);
+            if (!findIntersectionsInNode(node, visitor, buffers))
+                return false;
+            if (!isLeaf(node))
+            {
+                // Values in this node can intersect values in descendants
+                for (auto i = std::size_t(0); i < 4; ++i)
+                {
+                    if (!findIntersectionsInDescendants(node, mNodes.getChild(node, i), visitor, buffers))
+                        return false;
+                }
+                // Find intersections in children
+                for (auto i = std::size_t(0); i < 4; ++i)
+                    stack.push(mNodes.getChild(node, 3 - i));
+            }
         }
-        node->values = std::move(newValues);
+        return true;
     }
 
-    bool remove(Node* node, const Box<Float>& box, const T& value)
+    void findAllIntersections(ThreadPool& pool, const Node* node, std::size_t depth,
+        std::vector<std::vector<std::pair<T, T>>>& intersections, std::size_t worker) const
     {
-        assert(node != nullptr);
-        assert(box.contains(mGetBox(value)));
-        if (isLeaf(node))
+        // Small subtrees are processed by a single task
+        if (depth >= ParallelMaxDepth || isLeaf(node))
         {
-            // Remove the value from node
-            removeValue(node, value);
-            return true;
+            auto visitor = PairInserter{intersections[worker]};
+            findAllIntersections(node, visitor);
+            return;
         }
-        else
+        auto visitor = PairInserter{intersections[worker]};
+        auto buffers = SweepBuffers();
+        findIntersectionsInNode(node, visitor, buffers);
+        for (auto i = std::size_t(0); i < 4; ++i)
         {
-            // Remove the value in a child if the value is entirely contained in it
-            auto i = getQuadrant(box, mGetBox(value));
-            if (i != -1)
+            auto child = mNodes.getChild(node, i);
+            // Values in this node can intersect values in descendants
+            if (node->values.size() >= ParallelMinValues)
             {
-                if (remove(node->children[static_cast<std::size_t>(i)].get(), computeBox(box, i), value))
-                    return tryMerge(node);
+                pool.spawn(worker, [this, node, child, &intersections](std::size_t thief)
+                {
+                    auto thiefVisitor = PairInserter{intersections[thief]};
+                    auto thiefBuffers = SweepBuffers();
+                    prepareSweep(node, thiefBuffers);
+                    findIntersectionsInDescendants(node, child, thiefVisitor, thiefBuffers);
+                });
             }
-            // Otherwise, we remove the value from the current node
             else
-                removeValue(node, value);
-            return false;
+                findIntersectionsInDescendants(node, child, visitor, buffers);
+            // Find intersections in children
+            pool.spawn(worker, [this, &pool, child, depth, &intersections](std::size_t thief)
+            {
+                findAllIntersections(pool, child, depth + 1, intersections, thief);
+            });
         }
     }
 
-    void removeValue(Node* node, const T& value)
+    // Best-first traversal, nodes are visited by increasing distance to point
+    // and the traversal stops when they are farther than the k-th nearest value
+    // getNodeDistance(bounds) must return the distance from point to bounds in
+    // the same unit as getDistance
+    template<typename GetDistance, typename GetNodeDistance>
+    std::vector<T> findNearest(const Node* root, std::size_t k, Float maxDistance, const GetDistance& getDistance,
+        const GetNodeDistance& getNodeDistance) const
     {
-        // Find the value in node->values
-        auto it = std::find_if(std::begin(node->values), std::end(node->values),
-            [this, &value](const auto& rhs){ return mEqual(value, rhs); });
-        assert(it != std::end(node->values) && "Trying to remove a value that is not present in the node");
-        // Swap with the last element and pop back
-        *it = std::move(node->values.back());
-        node->values.pop_back();
+        struct Candidate
+        {
+            Float distance;
+            const Node* node;
+            Box<Float> box;
+        };
+        auto compareCandidates = [](const Candidate& lhs, const Candidate& rhs){ return lhs.distance > rhs.distance; };
+        auto candidates = std::priority_queue<Candidate, std::vector<Candidate>, decltype(compareCandidates)>(
+            compareCandidates);
+        // Max-heap of the k nearest values found so far
+        auto nearest = std::vector<std::pair<Float, T>>();
+        auto compareValues = [](const std::pair<Float, T>& lhs, const std::pair<Float, T>& rhs)
+        {
+            return lhs.first < rhs.first;
+        };
+        // Return true if a value or a node at distance may contain one of the k nearest values
+        auto isCloser = [&nearest, k, maxDistance](Float distance)
+        {
+            return nearest.size() < k ? distance <= maxDistance : distance < nearest.front().first;
+        };
+        auto rootDistance = getNodeDistance(Bounds<Float>::fromBox(mBox));
+        if (k > 0 && isCloser(rootDistance))
+            candidates.push(Candidate{rootDistance, root, mBox});
+        while (!candidates.empty() && isCloser(candidates.top().distance))
+        {
+            auto candidate = candidates.top();
+            candidates.pop();
+            auto node = candidate.node;
+            mCounters.addNodesVisited(1);
+            mCounters.addBoxesTested(node->values.size() + (isLeaf(node) ? 0 : 4));
+            for (auto i = std::size_t(0); i < node->values.size(); ++i)
+            {
+                auto distance = getDistance(node, i);
+                if (isCloser(distance))
+                {
+                    nearest.emplace_back(distance, node->values[i]);
+                    std::push_heap(std::begin(nearest), std::end(nearest), compareValues);
+                    if (nearest.size() > k)
+                    {
+                        std::pop_heap(std::begin(nearest), std::end(nearest), compareValues);
+                        nearest.pop_back();
+                    }
+                }
+            }
+            if (!isLeaf(node))
+            {
+                for (auto i = std::size_t(0); i < 4; ++i)
+                {
+                    auto childBox = computeBox(candidate.box, static_cast<int>(i));
+                    auto distance = getNodeDistance(Bounds<Float>::fromBox(childBox));
+                    if (isCloser(distance))
+                        candidates.push(Candidate{distance, mNodes.getChild(node, i), childBox});
+                }
+            }
+        }
+        std::sort_heap(std::begin(nearest), std::end(nearest), compareValues);
+        auto values = std::vector<T>();
+        values.reserve(nearest.size());
+        for (const auto& [distance, value] : nearest)
+            values.push_back(value);
+        return values;
     }
 
-    bool tryMerge(Node* node)
+    // Nodes and values are visited by increasing t, as the box of a node
+    // contains the boxes of its values, they are never hit before it
+    template<typename Visitor>
+    bool raycast(const Node* root, const Vector2<Float>& origin, const Vector2<Float>& direction, Float maxT,
+        Visitor& visitor) const
     {
-        assert(node != nullptr);
-        assert(!isLeaf(node) && "Only interior nodes can be merged");
-        auto nbValues = node->values.size();
-        for (const auto& child : node->children)
+        // Node candidates have no value index
+        constexpr auto NoValue = std::numeric_limits<std::size_t>::max();
+        struct Candidate
         {
-            if (!isLeaf(child.get()))
-                return false;
-            nbValues += child->values.size();
-        }
-        if (nbValues <= Threshold)
+            Float t;
+            const Node* node;
+            Box<Float> box;
+            std::size_t i;
+        };
+        auto compare = [](const Candidate& lhs, const Candidate& rhs){ return lhs.t > rhs.t; };
+        auto candidates = std::priority_queue<Candidate, std::vector<Candidate>, decltype(compare)>(compare);
+        auto t = Float(0);
+        if (Bounds<Float>::fromBox(mBox).intersects(origin, direction, maxT, t))
+            candidates.push(Candidate{t, root, mBox, NoValue});
+        while (!candidates.empty())
         {
-            node->values.reserve(nbValues);
-            // Merge the values of all the children
-            for (const auto& child : node->children)
+            auto candidate = candidates.top();
+            candidates.pop();
+            auto node = candidate.node;
+            if (candidate.i != NoValue)
             {
-                for (const auto& value : child->values)
-                    node->values.push_back(value);
+                if (visitor(node->values[candidate.i], candidate.t))
+                    return true;
+                continue;
+            }
+            mCounters.addNodesVisited(1);
+            mCounters.addBoxesTested(node->values.size() + (isLeaf(node) ? 0 : 4));
+            for (auto i = std::size_t(0); i < node->values.size(); ++i)
+            {
+                if (node->values.getBounds(i, mGetBox).intersects(origin, direction, maxT, t))
+                    candidates.push(Candidate{t, node, candidate.box, i});
+            }
+            if (!isLeaf(node))
+            {
+                for (auto i = std::size_t(0); i < 4; ++i)
+                {
+                    auto childBox = computeBox(candidate.box, static_cast<int>(i));
+                    if (Bounds<Float>::fromBox(childBox).intersects(origin, direction, maxT, t))
+                        candidates.push(Candidate{t, mNodes.getChild(node, i), childBox, NoValue});
+                }
             }
-            // Remove the children
-            for (auto& child : node->children)
-                child.reset();
-            return true;
         }
-        else
-            return false;
+        return false;
     }
 
-    void query(Node* node, const Box<Float>& box, const Box<Float>& queryBox, std::vector<T>& values) const
+    // Join the subtree of node1 in this tree and the subtree of node2 in
+    // other, their boxes must intersect
+    // A value of node1 is tested against the values of node2 and of the
+    // descendants of node2 intersecting it, and reciprocally, then the pairs
+    // of children are joined, so each pair of values is tested once
+    template<typename OtherQuadtree, typename Visitor>
+    bool findIntersections(const Node* node1, const Box<Float>& box1, const OtherQuadtree& other,
+        const typename OtherQuadtree::Node* node2, const Box<Float>& box2, Visitor& visitor) const
     {
-        assert(node != nullptr);
-        assert(queryBox.intersects(box));
-        for (const auto& value : node->values)
+        mCounters.addNodesVisited(1);
+        // Values of node1 against values of node2
+        for (auto i = std::size_t(0); i < node1->values.size(); ++i)
         {
-            if (queryBox.intersects(mGetBox(value)))
-                values.push_back(value);
+            const auto& value1 = node1->values[i];
+            if (!other.forEachIntersectingValue(node2->values, 0, node2->values.size(),
+                node1->values.getBounds(i, mGetBox),
+                [&visitor, &value1, node2](std::size_t j){ return visit(visitor, value1, node2->values[j]); }))
+                return false;
         }
-        if (!isLeaf(node))
+        auto childBoxes1 = std::array<Box<Float>, 4>();
+        auto childBoxes2 = std::array<Box<Float>, 4>();
+        // Values of node1 against values of the descendants of node2
+        if (!other.isLeaf(node2))
+        {
+            for (auto j = std::size_t(0); j < 4; ++j)
+            {
+                childBoxes2[j] = computeBox(box2, static_cast<int>(j));
+                auto childBounds2 = Bounds<Float>::fromBox(childBoxes2[j]);
+                for (auto i = std::size_t(0); i < node1->values.size(); ++i)
+                {
+                    const auto& value1 = node1->values[i];
+                    auto bounds1 = node1->values.getBounds(i, mGetBox);
+                    auto valueVisitor = [&visitor, &value1](const auto& value2){ return visit(visitor, value1, value2); };
+                    if (bounds1.intersects(childBounds2) &&
+                        !other.query(other.mNodes.getChild(node2, j), childBoxes2[j], bounds1, valueVisitor))
+                        return false;
+                }
+            }
+        }
+        // Values of node2 against values of the descendants of node1
+        if (!isLeaf(node1))
+        {
+            for (auto i = std::size_t(0); i < 4; ++i)
+            {
+                childBoxes1[i] = computeBox(box1, static_cast<int>(i));
+                auto childBounds1 = Bounds<Float>::fromBox(childBoxes1[i]);
+                for (auto j = std::size_t(0); j < node2->values.size(); ++j)
+                {
+                    const auto& value2 = node2->values[j];
+                    auto bounds2 = node2->values.getBounds(j, other.mGetBox);
+                    auto valueVisitor = [&visitor, &value2](const T& value1){ return visit(visitor, value1, value2); };
+                    if (bounds2.intersects(childBounds1) &&
+                        !query(mNodes.getChild(node1, i), childBoxes1[i], bounds2, valueVisitor))
+                        return false;
+                }
+            }
+        }
+        // Join the pairs of children whose boxes intersect
+        if (!isLeaf(node1) && !other.isLeaf(node2))
         {
-            for (auto i = std::size_t(0); i < node->children.size(); ++i)
+            mCounters.addBoxesTested(16);
+            for (auto i = std::size_t(0); i < 4; ++i)
             {
-                auto childBox = computeBox(box, static_cast<int>(i));
-                if (queryBox.intersects(childBox))
-                    query(node->children[i].get(), childBox, queryBox, values);
+                auto childBounds1 = Bounds<Float>::fromBox(childBoxes1[i]);
+                for (auto j = std::size_t(0); j < 4; ++j)
+                {
+                    if (childBounds1.intersects(Bounds<Float>::fromBox(childBoxes2[j])) &&
+                        !findIntersections(mNodes.getChild(node1, i), childBoxes1[i], other,
+                            other.mNodes.getChild(node2, j), childBoxes2[j], visitor))
+                        return false;
+                }
             }
         }
+        return true;
     }
 
-    void findAllIntersections(Node* node, std::vector<std::pair<T, T>>& intersections) const
+    // visitor is called with value and each value intersecting it
+    template<typename Visitor>
+    bool findIntersections(const Node* root, const Box<Float>& rootBox, const T& value, const Bounds<Float>& valueBounds,
+        Visitor& visitor) const
     {
+        assert(root != nullptr);
+        auto node = root;
+        auto box = rootBox;
+        while (true)
+        {
+            mCounters.addNodesVisited(1);
+            auto i = isLeaf(node) ? -1 : getQuadrant(box, valueBounds);
+            // Value is stored in this node, test it against the values of this node and of its descendants
+            if (i == -1)
+                return findIntersectionsInDescendants(node, value, valueBounds, visitor);
+            // Otherwise, test it against the values of this node and go down
+            if (!forEachIntersectingValue(node->values, 0, node->values.size(), valueBounds,
+                [&visitor, &value, node](std::size_t j){ return visit(visitor, value, node->values[j]); }))
+                return false;
+            node = mNodes.getChild(node, static_cast<std::size_t>(i));
+            box = computeBox(box, i);
+        }
+    }
+
+    // If node is large, its values are left sorted in buffers.values for
+    // findIntersectionsInDescendants
+    template<typename Visitor>
+    bool findIntersectionsInNode(const Node* node, Visitor& visitor, SweepBuffers& buffers) const
+    {
+        if (prepareSweep(node, buffers))
+            return sweep(buffers.values, visitor);
         // Find intersections between values stored in this node
         // Make sure to not report the same intersection twice
         for (auto i = std::size_t(0); i < node->values.size(); ++i)
         {
-            for (auto j = std::size_t(0); j < i; ++j)
+            if (!forEachIntersectingValue(node->values, 0, i, node->values.getBounds(i, mGetBox),
+                [&visitor, node, i](std::size_t j){ return visit(visitor, node->values[i], node->values[j]); }))
+                return false;
+        }
+        return true;
+    }
+
+    // If ancestor is large, buffers.values must contain its sorted values
+    template<typename Visitor>
+    bool findIntersectionsInDescendants(const Node* ancestor, const Node* node, Visitor& visitor,
+        SweepBuffers& buffers) const
+    {
+        if (ancestor->values.size() >= SweepMinValues)
+        {
+            assert(buffers.values.size() == ancestor->values.size());
+            buffers.descendants.clear();
+            appendSweepEntries(node, buffers.descendants);
+            sortSweepEntries(buffers.descendants);
+            return sweep(buffers.values, buffers.descendants, visitor);
+        }
+        for (auto i = std::size_t(0); i < ancestor->values.size(); ++i)
+        {
+            if (!findIntersectionsInDescendants(node, ancestor->values[i], ancestor->values.getBounds(i, mGetBox),
+                visitor))
+                return false;
+        }
+        return true;
+    }
+
+    template<typename Visitor>
+    bool findIntersectionsInDescendants(const Node* root, const T& value, const Bounds<Float>& valueBounds,
+        Visitor& visitor) const
+    {
+        auto stack = TraversalStack<const Node*, Parameters::getMaxDepthBound()>();
+        stack.push(root);
+        while (!stack.empty())
+        {
+            auto node = stack.pop();
+            mCounters.addNodesVisited(1);
+            // Test against the values stored in this node
+            if (!forEachIntersectingValue(node->values, 0, node->values.size(), valueBounds,
+                [&visitor, &value, node](std::size_t i){ return visit(visitor, value, node->values[i]); }))
+                return false;
+            // Test against values stored into descendants of this node
+            if (!isLeaf(node))
             {
-                if (mGetBox(node->values[i]).intersects(mGetBox(node->values[j])))
-                    intersections.emplace_back(node->values[i], node->values[j]);
+                for (auto i = std::size_t(0); i < 4; ++i)
+                    stack.push(mNodes.getChild(node, 3 - i));
             }
         }
-        if (!isLeaf(node))
+        return true;
+    }
+
+    // Sort the values of node in buffers.values if the node is large enough
+    // to be swept, return true in that case
+    bool prepareSweep(const Node* node, SweepBuffers& buffers) const
+    {
+        if (node->values.size() < SweepMinValues)
+            return false;
+        buffers.values.clear();
+        buffers.values.reserve(node->values.size());
+        for (auto i = std::size_t(0); i < node->values.size(); ++i)
+            buffers.values.push_back(SweepEntry{node->values.getBounds(i, mGetBox), &node->values[i]});
+        sortSweepEntries(buffers.values);
+        return true;
+    }
+
+    // Append the values of the subtree of root to entries
+    void appendSweepEntries(const Node* root, std::vector<SweepEntry>& entries) const
+    {
+        auto stack = TraversalStack<const Node*, Parameters::getMaxDepthBound()>();
+        stack.push(root);
+        while (!stack.empty())
         {
-            // Values in this node can intersect values in descendants
-            for (const auto& child : node->children)
+            auto node = stack.pop();
+            mCounters.addNodesVisited(1);
+            for (auto i = std::size_t(0); i < node->values.size(); ++i)
+                entries.push_back(SweepEntry{node->values.getBounds(i, mGetBox), &node->values[i]});
+            if (!isLeaf(node))
             {
-                for (const auto& value : node->values)
-                    findIntersectionsInDescendants(child.get(), value, intersections);
+                for (auto i = std::size_t(0); i < 4; ++i)
+                    stack.push(mNodes.getChild(node, i));
             }
-            // Find intersections in children
-            for (const auto& child : node->children)
-                findAllIntersections(child.get(), intersections);
         }
     }
 
-    void findIntersectionsInDescendants(Node* node, const T& value, std::vector<std::pair<T, T>>& intersections) const
+    static void sortSweepEntries(std::vector<SweepEntry>& entries)
     {
-        // Test against the values stored in this node
-        for (const auto& other : node->values)
+        std::sort(std::begin(entries), std::end(entries),
+            [](const SweepEntry& lhs, const SweepEntry& rhs){ return lhs.bounds.left < rhs.bounds.left; });
+    }
+
+    // Return the end of the entries after first whose left side is before right,
+    // only them can intersect an entry ending at right
+    static std::size_t findActiveEnd(const std::vector<SweepEntry>& entries, std::size_t first, Float right)
+    {
+        auto last = first;
+        while (last < entries.size() && entries[last].bounds.left < right)
+            ++last;
+        return last;
+    }
+
+    // Sweep entries sorted by left side, each entry is only tested against the
+    // next entries starting before its right side
+    template<typename Visitor>
+    bool sweep(const std::vector<SweepEntry>& entries, Visitor& visitor) const
+    {
+        for (auto i = std::size_t(0); i < entries.size(); ++i)
         {
-            if (mGetBox(value).intersects(mGetBox(other)))
-                intersections.emplace_back(value, other);
+            const auto& entry = entries[i];
+            auto last = findActiveEnd(entries, i + 1, entry.bounds.right);
+            mCounters.addBoxesTested(last - i - 1);
+            for (auto j = i + 1; j < last; ++j)
+            {
+                if (entry.bounds.intersects(entries[j].bounds) && !visit(visitor, *entries[j].value, *entry.value))
+                    return false;
+            }
         }
-        // Test against values stored into descendants of this node
-        if (!isLeaf(node))
+        return true;
+    }
+
+    // Same as above but between two sets of entries, the entry starting first
+    // is tested against the entries of the other set, visitor is called with
+    // a value of entries1 then a value of entries2
+    template<typename Visitor>
+    bool sweep(const std::vector<SweepEntry>& entries1, const std::vector<SweepEntry>& entries2,
+        Visitor& visitor) const
+    {
+        auto i = std::size_t(0);
+        auto j = std::size_t(0);
+        while (i < entries1.size() && j < entries2.size())
         {
-            for (const auto& child : node->children)
-                findIntersectionsInDescendants(child.get(), value, intersections);
+            if (entries1[i].bounds.left <= entries2[j].bounds.left)
+            {
+                const auto& entry = entries1[i];
+                auto last = findActiveEnd(entries2, j, entry.bounds.right);
+                mCounters.addBoxesTested(last - j);
+                for (auto k = j; k < last; ++k)
+                {
+                    if (entry.bounds.intersects(entries2[k].bounds) && !visit(visitor, *entry.value, *entries2[k].value))
+                        return false;
+                }
+                ++i;
+            }
+            else
+            {
+                const auto& entry = entries2[j];
+                auto last = findActiveEnd(entries1, i, entry.bounds.right);
+                mCounters.addBoxesTested(last - i);
+                for (auto k = i; k < last; ++k)
+                {
+                    if (entry.bounds.intersects(entries1[k].bounds) && !visit(visitor, *entries1[k].value, *entry.value))
+                        return false;
+                }
+                ++j;
+            }
         }
+        return true;
     }
 };
 
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include "Bounds.h"
+
+#if !defined(QUADTREE_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    #define QUADTREE_SIMD_X86
+    #include <immintrin.h>
+#endif
+
+namespace quadtree
+{
+
+// Kernels writing in indices the indices i in [first, last) such that bounds
+// intersects boxes[i], they return the number of indices written
+
+template<typename Float>
+std::size_t findIntersectingBoundsScalar(const Bounds<Float>& bounds, const BoundsArrays<Float>& boxes,
+    std::size_t first, std::size_t last, std::size_t* indices)
+{
+    auto count = std::size_t(0);
+    for (auto i = first; i < last; ++i)
+    {
+        if (bounds.intersects(boxes[i]))
+            indices[count++] = i;
+    }
+    return count;
+}
+
+#ifdef QUADTREE_SIMD_X86
+
+// The comparisons are negated like in Bounds::intersects so that the kernels
+// give exactly the same results as the scalar version
+
+__attribute__((target("sse2")))
+inline std::size_t findIntersectingBoundsSse(const Bounds<float>& bounds, const BoundsArrays<float>& boxes,
+    std::size_t first, std::size_t last, std::size_t* indices)
+{
+    auto left = _mm_set1_ps(bounds.left);
+    auto top = _mm_set1_ps(bounds.top);
+    auto right = _mm_set1_ps(bounds.right);
+    auto bottom = _mm_set1_ps(bounds.bottom);
+    auto count = std::size_t(0);
+    auto i = first;
+    for (; i + 4 <= last; i += 4)
+    {
+        auto horizontal = _mm_and_ps(_mm_cmpnge_ps(left, _mm_loadu_ps(boxes.rights + i)),
+            _mm_cmpnle_ps(right, _mm_loadu_ps(boxes.lefts + i)));
+        auto vertical = _mm_and_ps(_mm_cmpnge_ps(top, _mm_loadu_ps(boxes.bottoms + i)),
+            _mm_cmpnle_ps(bottom, _mm_loadu_ps(boxes.tops + i)));
+        auto mask = static_cast<unsigned int>(_mm_movemask_ps(_mm_and_ps(horizontal, vertical)));
+        for (; mask != 0; mask &= mask - 1)
+            indices[count++] = i + static_cast<std::size_t>(__builtin_ctz(mask));
+    }
+    return count + findIntersectingBoundsScalar(bounds, boxes, i, last, indices + count);
+}
+
+__attribute__((target("avx2")))
+inline std::size_t findIntersectingBoundsAvx2(const Bounds<float>& bounds, const BoundsArrays<float>& boxes,
+    std::size_t first, std::size_t last, std::size_t* indices)
+{
+    auto left = _mm256_set1_ps(bounds.left);
+    auto top = _mm256_set1_ps(bounds.top);
+    auto right = _mm256_set1_ps(bounds.right);
+    auto bottom = _mm256_set1_ps(bounds.bottom);
+    auto count = std::size_t(0);
+    auto i = first;
+    for (; i + 8 <= last; i += 8)
+    {
+        auto horizontal = _mm256_and_ps(_mm256_cmp_ps(left, _mm256_loadu_ps(boxes.rights + i), _CMP_NGE_UQ),
+            _mm256_cmp_ps(right, _mm256_loadu_ps(boxes.lefts + i), _CMP_NLE_UQ));
+        auto vertical = _mm256_and_ps(_mm256_cmp_ps(top, _mm256_loadu_ps(boxes.bottoms + i), _CMP_NGE_UQ),
+            _mm256_cmp_ps(bottom, _mm256_loadu_ps(boxes.tops + i), _CMP_NLE_UQ));
+        auto mask = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_and_ps(horizontal, vertical)));
+        for (; mask != 0; mask &= mask - 1)
+            indices[count++] = i + static_cast<std::size_t>(__builtin_ctz(mask));
+    }
+    return count + findIntersectingBoundsSse(bounds, boxes, i, last, indices + count);
+}
+
+__attribute__((target("avx512f")))
+inline std::size_t findIntersectingBoundsAvx512(const Bounds<float>& bounds, const BoundsArrays<float>& boxes,
+    std::size_t first, std::size_t last, std::size_t* indices)
+{
+    auto left = _mm512_set1_ps(bounds.left);
+    auto top = _mm512_set1_ps(bounds.top);
+    auto right = _mm512_set1_ps(bounds.right);
+    auto bottom = _mm512_set1_ps(bounds.bottom);
+    auto count = std::size_t(0);
+    auto i = first;
+    for (; i + 16 <= last; i += 16)
+    {
+        auto mask = _mm512_cmp_ps_mask(left, _mm512_loadu_ps(boxes.rights + i), _CMP_NGE_UQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, right, _mm512_loadu_ps(boxes.lefts + i), _CMP_NLE_UQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, top, _mm512_loadu_ps(boxes.bottoms + i), _CMP_NGE_UQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, bottom, _mm512_loadu_ps(boxes.tops + i), _CMP_NLE_UQ);
+        for (auto bits = static_cast<unsigned int>(mask); bits != 0; bits &= bits - 1)
+            indices[count++] = i + static_cast<std::size_t>(__builtin_ctz(bits));
+    }
+    return count + findIntersectingBoundsAvx2(bounds, boxes, i, last, indices + count);
+}
+
+#endif
+
+using FindIntersectingBoundsKernel = std::size_t(*)(const Bounds<float>&, const BoundsArrays<float>&,
+    std::size_t, std::size_t, std::size_t*);
+
+// Select the widest kernel supported by the CPU
+inline FindIntersectingBoundsKernel selectFindIntersectingBoundsKernel()
+{
+#ifdef QUADTREE_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return &findIntersectingBoundsAvx512;
+    if (__builtin_cpu_supports("avx2"))
+        return &findIntersectingBoundsAvx2;
+    if (__builtin_cpu_supports("sse2"))
+        return &findIntersectingBoundsSse;
+#endif
+    return &findIntersectingBoundsScalar<float>;
+}
+
+template<typename Float>
+std::size_t findIntersectingBounds(const Bounds<Float>& bounds, const BoundsArrays<Float>& boxes,
+    std::size_t first, std::size_t last, std::size_t* indices)
+{
+    if constexpr (std::is_same_v<Float, float>)
+    {
+        static const auto kernel = selectFindIntersectingBoundsKernel();
+        return kernel(bounds, boxes, first, last, indices);
+    }
+    else
+        return findIntersectingBoundsScalar(bounds, boxes, first, last, indices);
+}
+
+// Call f(i) for each i in [first, last) such that bounds intersects boxes[i],
+// stop as soon as f returns false and return false in that case, the indices
+// are computed by chunks so that no allocation is needed
+template<typename Float, typename F>
+bool forEachIntersectingBounds(const Bounds<Float>& bounds, const BoundsArrays<Float>& boxes,
+    std::size_t first, std::size_t last, F&& f)
+{
+    // Small ranges are not worth the indirect call
+    if (last - first < 8)
+    {
+        for (auto i = first; i < last; ++i)
+        {
+            if (bounds.intersects(boxes[i]) && !f(i))
+                return false;
+        }
+        return true;
+    }
+    std::array<std::size_t, 64> indices; // Left uninitialized on purpose
+    for (auto begin = first; begin < last; begin += indices.size())
+    {
+        auto end = std::min(begin + indices.size(), last);
+        auto count = findIntersectingBounds(bounds, boxes, begin, end, indices.data());
+        for (auto i = std::size_t(0); i < count; ++i)
+        {
+            if (!f(indices[i]))
+                return false;
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,377 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Box.h"
+#include "Parameters.h"
+#include "Quadrant.h"
+#include "Simd.h"
+
+namespace quadtree
+{
+
+// Binary snapshot of a quadtree written by Quadtree::writeSnapshot, it starts
+// with a SnapshotHeader followed by the nodes and the values, the four children
+// of a node are contiguous, the groups of children are stored in depth-first
+// order so the root is followed by the children of the root, then the children
+// of the first child of the root and so on, and the values of a node are
+// contiguous, the bounds of the values are stored in structure-of-arrays layout
+// All the offsets are relative to the beginning of the snapshot so that it can
+// be mapped at any address, integers and floats are in native byte order
+
+inline constexpr auto SnapshotMagic = std::uint64_t(0x313050414e535451); // "QTSNAP01" in little endian
+inline constexpr auto SnapshotAlignment = std::size_t(64); // Alignment of the sections
+
+template<typename Float>
+struct SnapshotHeader
+{
+    std::uint64_t magic;
+    std::uint32_t valueSize;
+    std::uint32_t floatSize;
+    Box<Float> box;
+    std::uint64_t nbNodes;
+    std::uint64_t nbValues;
+    std::uint64_t size; // Total size of the snapshot
+    std::uint64_t nodesOffset;
+    std::uint64_t valuesOffset;
+    std::uint64_t leftsOffset;
+    std::uint64_t topsOffset;
+    std::uint64_t rightsOffset;
+    std::uint64_t bottomsOffset;
+};
+
+struct SnapshotNode
+{
+    std::uint32_t firstChild; // Zero for leaves as the root can not be a child
+    std::uint32_t firstValue;
+    std::uint32_t nbValues;
+};
+
+// Flattened tree filled by Quadtree::buildSnapshot, clearing the buffers keeps
+// their capacity so that they can be refilled without allocation
+template<typename T, typename Float>
+struct SnapshotBuffers
+{
+    Box<Float> box;
+    std::vector<SnapshotNode> nodes;
+    std::vector<T> values;
+    std::vector<Float> lefts;
+    std::vector<Float> tops;
+    std::vector<Float> rights;
+    std::vector<Float> bottoms;
+
+    void clear()
+    {
+        nodes.clear();
+        values.clear();
+        lefts.clear();
+        tops.clear();
+        rights.clear();
+        bottoms.clear();
+    }
+};
+
+// Write a snapshot made of the flattened tree in buffers
+template<typename T, typename Float>
+void writeSnapshot(std::ostream& out, const SnapshotBuffers<T, Float>& buffers)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+    static_assert(alignof(T) <= SnapshotAlignment);
+    auto align = [](std::uint64_t offset)
+    {
+        return (offset + SnapshotAlignment - 1) / SnapshotAlignment * SnapshotAlignment;
+    };
+    auto header = SnapshotHeader<Float>();
+    header.magic = SnapshotMagic;
+    header.valueSize = sizeof(T);
+    header.floatSize = sizeof(Float);
+    const auto& [box, nodes, values, lefts, tops, rights, bottoms] = buffers;
+    header.box = box;
+    header.nbNodes = nodes.size();
+    header.nbValues = values.size();
+    header.nodesOffset = align(sizeof(header));
+    header.valuesOffset = align(header.nodesOffset + nodes.size() * sizeof(SnapshotNode));
+    header.leftsOffset = align(header.valuesOffset + values.size() * sizeof(T));
+    header.topsOffset = align(header.leftsOffset + values.size() * sizeof(Float));
+    header.rightsOffset = align(header.topsOffset + values.size() * sizeof(Float));
+    header.bottomsOffset = align(header.rightsOffset + values.size() * sizeof(Float));
+    header.size = header.bottomsOffset + values.size() * sizeof(Float);
+    // Write the sections with zero padding between them
+    auto position = std::uint64_t(0);
+    auto write = [&out, &position](std::uint64_t offset, const void* data, std::size_t size)
+    {
+        static constexpr char Zeros[SnapshotAlignment] = {};
+        out.write(Zeros, static_cast<std::streamsize>(offset - position));
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        position = offset + size;
+    };
+    write(0, &header, sizeof(header));
+    write(header.nodesOffset, nodes.data(), nodes.size() * sizeof(SnapshotNode));
+    write(header.valuesOffset, values.data(), values.size() * sizeof(T));
+    write(header.leftsOffset, lefts.data(), lefts.size() * sizeof(Float));
+    write(header.topsOffset, tops.data(), tops.size() * sizeof(Float));
+    write(header.rightsOffset, rights.data(), rights.size() * sizeof(Float));
+    write(header.bottomsOffset, bottoms.data(), bottoms.size() * sizeof(Float));
+}
+
+// Read-only quadtree over a snapshot, nothing is copied so the snapshot must
+// outlive the tree
+template<typename T, typename Float = float>
+class SnapshotQuadtree
+{
+    static_assert(std::is_arithmetic_v<Float>);
+
+public:
+    // Throw std::runtime_error if data is not a valid snapshot for T and Float,
+    // data must be aligned on SnapshotAlignment bytes
+    SnapshotQuadtree(const void* data, std::size_t size) :
+        mData(static_cast<const unsigned char*>(data))
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+        assert(reinterpret_cast<std::uintptr_t>(data) % SnapshotAlignment == 0 && "The snapshot must be aligned");
+        if (size < sizeof(Header))
+            throw std::runtime_error("Snapshot too small");
+        std::memcpy(&mHeader, mData, sizeof(Header));
+        if (mHeader.magic != SnapshotMagic)
+            throw std::runtime_error("Not a quadtree snapshot");
+        if (mHeader.valueSize != sizeof(T) || mHeader.floatSize != sizeof(Float))
+            throw std::runtime_error("Snapshot written with other value or float types");
+        if (mHeader.size > size || mHeader.nbNodes == 0 || mHeader.nbNodes > size || mHeader.nbValues > size ||
+            !isSectionValid(mHeader.nodesOffset, mHeader.nbNodes * sizeof(SnapshotNode)) ||
+            !isSectionValid(mHeader.valuesOffset, mHeader.nbValues * sizeof(T)) ||
+            !isSectionValid(mHeader.leftsOffset, mHeader.nbValues * sizeof(Float)) ||
+            !isSectionValid(mHeader.topsOffset, mHeader.nbValues * sizeof(Float)) ||
+            !isSectionValid(mHeader.rightsOffset, mHeader.nbValues * sizeof(Float)) ||
+            !isSectionValid(mHeader.bottomsOffset, mHeader.nbValues * sizeof(Float)))
+            throw std::runtime_error("Corrupted snapshot");
+        mNodes = reinterpret_cast<const SnapshotNode*>(mData + mHeader.nodesOffset);
+        mValues = reinterpret_cast<const T*>(mData + mHeader.valuesOffset);
+        mBoxes = BoundsArrays<Float>{reinterpret_cast<const Float*>(mData + mHeader.leftsOffset),
+            reinterpret_cast<const Float*>(mData + mHeader.topsOffset),
+            reinterpret_cast<const Float*>(mData + mHeader.rightsOffset),
+            reinterpret_cast<const Float*>(mData + mHeader.bottomsOffset)};
+        // Check the nodes so that traversals stay in the snapshot and are
+        // bounded: each group of children must be the next one in the order
+        // of a depth-first traversal, so it has exactly one parent, and the
+        // depth can not exceed MaxSupportedDepth
+        auto nextChild = std::uint64_t(1);
+        auto stack = std::vector<std::pair<std::size_t, std::size_t>>{{0, 0}}; // Node and depth
+        while (!stack.empty())
+        {
+            auto [i, depth] = stack.back();
+            stack.pop_back();
+            const auto& node = mNodes[i];
+            if (node.firstValue + std::uint64_t(node.nbValues) > mHeader.nbValues)
+                throw std::runtime_error("Corrupted snapshot");
+            if (!isLeaf(node))
+            {
+                if (node.firstChild != nextChild || nextChild + 4 > mHeader.nbNodes || depth >= MaxSupportedDepth)
+                    throw std::runtime_error("Corrupted snapshot");
+                nextChild += 4;
+                // Children are pushed in reverse order so that they are visited in order
+                for (auto j = std::size_t(4); j-- > 0;)
+                    stack.emplace_back(node.firstChild + j, depth + 1);
+            }
+        }
+        if (nextChild != mHeader.nbNodes)
+            throw std::runtime_error("Corrupted snapshot");
+    }
+
+    // Tree over buffers filled by Quadtree::buildSnapshot, they must not be
+    // modified while the tree is used
+    explicit SnapshotQuadtree(const SnapshotBuffers<T, Float>& buffers) :
+        mData(nullptr), mHeader(), mNodes(buffers.nodes.data()), mValues(buffers.values.data()),
+        mBoxes{buffers.lefts.data(), buffers.tops.data(), buffers.rights.data(), buffers.bottoms.data()}
+    {
+        assert(!buffers.nodes.empty() && "The buffers must contain at least the root");
+        mHeader.box = buffers.box;
+        mHeader.nbNodes = buffers.nodes.size();
+        mHeader.nbValues = buffers.values.size();
+    }
+
+    std::size_t size() const
+    {
+        return mHeader.nbValues;
+    }
+
+    std::vector<T> query(const Box<Float>& box) const
+    {
+        auto values = std::vector<T>();
+        query(box, std::back_inserter(values));
+        return values;
+    }
+
+    // Call visitor(value) for each value intersecting box, if visitor returns
+    // a bool, the query stops as soon as it returns false
+    // Return false if the query has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&>, bool> query(const Box<Float>& box, Visitor&& visitor) const
+    {
+        return query(mNodes[0], mHeader.box, Bounds<Float>::fromBox(box), visitor);
+    }
+
+    // Write the values intersecting box in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&>, OutputIt> query(const Box<Float>& box, OutputIt out) const
+    {
+        query(box, [&out](const T& value){ *out++ = value; });
+        return out;
+    }
+
+    std::vector<std::pair<T, T>> findAllIntersections() const
+    {
+        auto intersections = std::vector<std::pair<T, T>>();
+        findAllIntersections(std::back_inserter(intersections));
+        return intersections;
+    }
+
+    // Call visitor(value1, value2) for each pair of intersecting values, if
+    // visitor returns a bool, the search stops as soon as it returns false
+    // Return false if the search has been stopped, true otherwise
+    template<typename Visitor>
+    std::enable_if_t<std::is_invocable_v<Visitor&, const T&, const T&>, bool> findAllIntersections(Visitor&& visitor) const
+    {
+        return findAllIntersections(mNodes[0], visitor);
+    }
+
+    // Write the pairs of intersecting values in out
+    template<typename OutputIt>
+    std::enable_if_t<!std::is_invocable_v<OutputIt&, const T&, const T&>, OutputIt> findAllIntersections(OutputIt out) const
+    {
+        findAllIntersections([&out](const T& value1, const T& value2){ *out++ = std::pair<T, T>(value1, value2); });
+        return out;
+    }
+
+    Box<Float> getBox() const
+    {
+        return mHeader.box;
+    }
+
+private:
+    using Header = SnapshotHeader<Float>;
+
+    const unsigned char* mData; // Null if the tree is over buffers
+    Header mHeader;
+    const SnapshotNode* mNodes;
+    const T* mValues;
+    BoundsArrays<Float> mBoxes;
+
+    bool isSectionValid(std::uint64_t offset, std::uint64_t sectionSize) const
+    {
+        return offset % SnapshotAlignment == 0 && offset <= mHeader.size && sectionSize <= mHeader.size - offset;
+    }
+
+    // Call visitor with args and return false if the traversal must stop
+    template<typename Visitor, typename... Args>
+    static bool visit(Visitor& visitor, const Args&... args)
+    {
+        if constexpr (std::is_same_v<std::invoke_result_t<Visitor&, const Args&...>, bool>)
+            return visitor(args...);
+        else
+        {
+            visitor(args...);
+            return true;
+        }
+    }
+
+    static bool isLeaf(const SnapshotNode& node)
+    {
+        return node.firstChild == 0;
+    }
+
+    const SnapshotNode& getChild(const SnapshotNode& node, std::size_t i) const
+    {
+        return mNodes[node.firstChild + i];
+    }
+
+    // Call f(i) for each value i of node intersecting bounds, first and last
+    // are relative to the first value of node but i is not
+    template<typename F>
+    bool forEachIntersectingValue(const SnapshotNode& node, std::size_t first, std::size_t last,
+        const Bounds<Float>& bounds, F&& f) const
+    {
+        return forEachIntersectingBounds(bounds, mBoxes, node.firstValue + first, node.firstValue + last,
+            std::forward<F>(f));
+    }
+
+    template<typename Visitor>
+    bool query(const SnapshotNode& node, const Box<Float>& box, const Bounds<Float>& queryBounds,
+        Visitor& visitor) const
+    {
+        if (!forEachIntersectingValue(node, 0, node.nbValues, queryBounds,
+            [this, &visitor](std::size_t i){ return visit(visitor, mValues[i]); }))
+            return false;
+        if (!isLeaf(node))
+        {
+            for (auto i = std::size_t(0); i < 4; ++i)
+            {
+                auto childBox = computeBox(box, static_cast<int>(i));
+                if (queryBounds.intersects(Bounds<Float>::fromBox(childBox)) &&
+                    !query(getChild(node, i), childBox, queryBounds, visitor))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    template<typename Visitor>
+    bool findAllIntersections(const SnapshotNode& node, Visitor& visitor) const
+    {
+        // Find intersections between values stored in this node
+        // Make sure to not report the same intersection twice
+        for (auto i = std::size_t(node.firstValue); i < node.firstValue + node.nbValues; ++i)
+        {
+            if (!forEachIntersectingValue(node, 0, i - node.firstValue, mBoxes[i],
+                [this, &visitor, i](std::size_t j){ return visit(visitor, mValues[i], mValues[j]); }))
+                return false;
+        }
+        if (!isLeaf(node))
+        {
+            // Values in this node can intersect values in descendants
+            for (auto i = std::size_t(node.firstValue); i < node.firstValue + node.nbValues; ++i)
+            {
+                for (auto j = std::size_t(0); j < 4; ++j)
+                {
+                    if (!findIntersectionsInDescendants(getChild(node, j), i, visitor))
+                        return false;
+                }
+            }
+            // Find intersections in children
+            for (auto i = std::size_t(0); i < 4; ++i)
+            {
+                if (!findAllIntersections(getChild(node, i), visitor))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // Find the intersections between the i-th value and the values of the subtree of node
+    template<typename Visitor>
+    bool findIntersectionsInDescendants(const SnapshotNode& node, std::size_t i, Visitor& visitor) const
+    {
+        // Test against the values stored in this node
+        if (!forEachIntersectingValue(node, 0, node.nbValues, mBoxes[i],
+            [this, &visitor, i](std::size_t j){ return visit(visitor, mValues[i], mValues[j]); }))
+            return false;
+        // Test against values stored into descendants of this node
+        if (!isLeaf(node))
+        {
+            for (auto j = std::size_t(0); j < 4; ++j)
+            {
+                if (!findIntersectionsInDescendants(getChild(node, j), i, visitor))
+                    return false;
+            }
+        }
+        return true;
+    }
+};
+
+}
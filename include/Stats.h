@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace quadtree
+{
+
+// Operation counters are only updated if QUADTREE_STATS is defined, otherwise
+// they cost nothing
+// The macro changes the layout of the trees, so it must be defined in all the
+// translation units of a program or in none of them, mixing them violates the
+// one definition rule
+#ifdef QUADTREE_STATS
+inline constexpr auto StatsEnabled = true;
+#else
+inline constexpr auto StatsEnabled = false;
+#endif
+
+// Work done by the operations of a tree since the last reset
+struct OperationCounters
+{
+    std::size_t nbNodesVisited = 0;
+    std::size_t nbBoxesTested = 0; // Boxes of values and of nodes
+    std::size_t nbSplits = 0;
+    std::size_t nbMerges = 0;
+    std::size_t nbAllocations = 0; // Groups of children created
+};
+
+// Counters updated concurrently by the operations of a tree, the
+// specialization for false is empty and does nothing
+template<bool Enabled>
+class AtomicOperationCounters
+{
+public:
+    AtomicOperationCounters() noexcept = default;
+
+    AtomicOperationCounters(const AtomicOperationCounters& other) noexcept
+    {
+        set(other.get());
+    }
+
+    AtomicOperationCounters& operator=(const AtomicOperationCounters& other) noexcept
+    {
+        set(other.get());
+        return *this;
+    }
+
+    void addNodesVisited(std::size_t n) noexcept
+    {
+        add(mNbNodesVisited, n);
+    }
+
+    void addBoxesTested(std::size_t n) noexcept
+    {
+        add(mNbBoxesTested, n);
+    }
+
+    void addSplit() noexcept
+    {
+        add(mNbSplits, 1);
+    }
+
+    void addMerge() noexcept
+    {
+        add(mNbMerges, 1);
+    }
+
+    void addAllocation() noexcept
+    {
+        add(mNbAllocations, 1);
+    }
+
+    OperationCounters get() const noexcept
+    {
+        auto counters = OperationCounters();
+        counters.nbNodesVisited = mNbNodesVisited.load(std::memory_order_relaxed);
+        counters.nbBoxesTested = mNbBoxesTested.load(std::memory_order_relaxed);
+        counters.nbSplits = mNbSplits.load(std::memory_order_relaxed);
+        counters.nbMerges = mNbMerges.load(std::memory_order_relaxed);
+        counters.nbAllocations = mNbAllocations.load(std::memory_order_relaxed);
+        return counters;
+    }
+
+    void reset() noexcept
+    {
+        set(OperationCounters());
+    }
+
+private:
+    std::atomic<std::size_t> mNbNodesVisited = 0;
+    std::atomic<std::size_t> mNbBoxesTested = 0;
+    std::atomic<std::size_t> mNbSplits = 0;
+    std::atomic<std::size_t> mNbMerges = 0;
+    std::atomic<std::size_t> mNbAllocations = 0;
+
+    static void add(std::atomic<std::size_t>& counter, std::size_t n) noexcept
+    {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void set(const OperationCounters& counters) noexcept
+    {
+        mNbNodesVisited.store(counters.nbNodesVisited, std::memory_order_relaxed);
+        mNbBoxesTested.store(counters.nbBoxesTested, std::memory_order_relaxed);
+        mNbSplits.store(counters.nbSplits, std::memory_order_relaxed);
+        mNbMerges.store(counters.nbMerges, std::memory_order_relaxed);
+        mNbAllocations.store(counters.nbAllocations, std::memory_order_relaxed);
+    }
+};
+
+template<>
+class AtomicOperationCounters<false>
+{
+public:
+    void addNodesVisited(std::size_t) noexcept
+    {
+
+    }
+
+    void addBoxesTested(std::size_t) noexcept
+    {
+
+    }
+
+    void addSplit() noexcept
+    {
+
+    }
+
+    void addMerge() noexcept
+    {
+
+    }
+
+    void addAllocation() noexcept
+    {
+
+    }
+
+    OperationCounters get() const noexcept
+    {
+        return OperationCounters();
+    }
+
+    void reset() noexcept
+    {
+
+    }
+};
+
+// Shape of a tree at a given time
+struct TreeStats
+{
+    std::size_t nbNodes = 0;
+    std::size_t nbLeaves = 0;
+    std::size_t nbValues = 0;
+    std::size_t nbValuesInInteriorNodes = 0; // Values that can not go down to a leaf
+    std::vector<std::size_t> nbNodesPerDepth;
+    std::vector<std::size_t> nbValuesPerDepth;
+    std::vector<std::size_t> nbNodesPerValueCount; // Number of nodes containing i values
+    std::size_t memoryUsage = 0; // In bytes, memory owned by the tree including unused capacity
+};
+
+}
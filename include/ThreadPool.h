@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace quadtree
+{
+
+// Work-stealing thread pool, each worker has its own queue, it takes the most
+// recent task of its queue and steals the oldest tasks of the others when its
+// queue is empty
+class ThreadPool
+{
+public:
+    // The argument of a task is the index of the worker that executes it
+    using Task = std::function<void(std::size_t)>;
+
+    explicit ThreadPool(std::size_t nbThreads = std::max(std::size_t(std::thread::hardware_concurrency()), std::size_t(1))) :
+        mQueues(std::make_unique<Queue[]>(std::max(nbThreads, std::size_t(1)))),
+        mNbWorkers(std::max(nbThreads, std::size_t(1)))
+    {
+        // The thread calling run is the worker 0
+        for (auto i = std::size_t(1); i < mNbWorkers; ++i)
+            mThreads.emplace_back([this, i](){ work(i); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            auto lock = std::lock_guard(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_all();
+        for (auto& thread : mThreads)
+            thread.join();
+    }
+
+    std::size_t getNbThreads() const
+    {
+        return mNbWorkers;
+    }
+
+    // Add a task to the queue of a worker, tasks can spawn other tasks
+    void spawn(std::size_t worker, Task task)
+    {
+        mNbPending.fetch_add(1, std::memory_order_relaxed);
+        {
+            auto lock = std::lock_guard(mQueues[worker].mutex);
+            mQueues[worker].tasks.push_back(std::move(task));
+        }
+        {
+            auto lock = std::lock_guard(mMutex);
+            ++mNbQueued;
+        }
+        mCondition.notify_one();
+    }
+
+    // Execute the task and all the tasks it spawns, the calling thread takes
+    // part in the work and run must not be called concurrently
+    void run(Task task)
+    {
+        spawn(0, std::move(task));
+        while (mNbPending.load(std::memory_order_acquire) > 0)
+        {
+            if (!tryExecute(0))
+                std::this_thread::yield();
+        }
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::unique_ptr<Queue[]> mQueues;
+    std::size_t mNbWorkers;
+    std::vector<std::thread> mThreads;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::size_t mNbQueued = 0; // Protected by mMutex
+    bool mStop = false; // Protected by mMutex
+    std::atomic<std::size_t> mNbPending = 0;
+
+    bool pop(std::size_t worker, Task& task)
+    {
+        // Take the most recent task of the worker
+        {
+            auto& queue = mQueues[worker];
+            auto lock = std::lock_guard(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                return true;
+            }
+        }
+        // Otherwise, steal the oldest task of another worker
+        for (auto i = std::size_t(1); i < mNbWorkers; ++i)
+        {
+            auto& queue = mQueues[(worker + i) % mNbWorkers];
+            auto lock = std::lock_guard(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool tryExecute(std::size_t worker)
+    {
+        auto task = Task();
+        if (!pop(worker, task))
+            return false;
+        {
+            auto lock = std::lock_guard(mMutex);
+            --mNbQueued;
+        }
+        task(worker);
+        mNbPending.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    void work(std::size_t worker)
+    {
+        while (true)
+        {
+            {
+                auto lock = std::unique_lock(mMutex);
+                mCondition.wait(lock, [this](){ return mStop || mNbQueued > 0; });
+                if (mStop)
+                    return;
+            }
+            tryExecute(worker);
+        }
+    }
+};
+
+}
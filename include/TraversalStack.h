@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cassert>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+namespace quadtree
+{
+
+// Fixed-size stack of the nodes left to visit by a depth-first traversal of a
+// tree whose depth is at most MaxDepth and whose nodes have NbChildren children
+// A visited node is popped and at most its children are pushed, so there are
+// at most NbChildren - 1 pending siblings per level plus the next node to visit
+// T must be trivially default constructible so that the stack is not
+// initialized when it is created
+template<typename T, std::size_t MaxDepth, std::size_t NbChildren = 4>
+class TraversalStack
+{
+    static_assert(std::is_trivially_default_constructible_v<T>, "T must be trivially default constructible");
+
+public:
+    // User-provided so that value-initializing the stack does not zero the values
+    TraversalStack() noexcept : mSize(0)
+    {
+
+    }
+
+    bool empty() const
+    {
+        return mSize == 0;
+    }
+
+    void push(const T& value)
+    {
+        assert(mSize < Capacity && "Traversal stack overflow");
+        mValues[mSize] = value;
+        ++mSize;
+    }
+
+    // value is always written but is only kept if condition is true, so that
+    // there is no branch to predict
+    void pushIf(const T& value, bool condition)
+    {
+        assert((mSize < Capacity || !condition) && "Traversal stack overflow");
+        mValues[mSize] = value;
+        mSize += static_cast<std::size_t>(condition);
+    }
+
+    T pop()
+    {
+        assert(mSize > 0);
+        --mSize;
+        return mValues[mSize];
+    }
+
+private:
+    static constexpr auto Capacity = (NbChildren - 1) * MaxDepth + 1;
+
+    // One more slot for the value written by pushIf when the stack is full
+    std::array<T, Capacity + 1> mValues;
+    std::size_t mSize;
+};
+
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Bounds.h"
+
+namespace quadtree
+{
+
+// Only the values are stored, their bounds are computed with GetBox when needed
+template<typename T, typename Float, typename Allocator = std::allocator<T>, std::size_t D = 2>
+class ValueVector
+{
+public:
+    ValueVector() = default;
+
+    explicit ValueVector(const Allocator& allocator) : mValues(allocator)
+    {
+
+    }
+
+    std::size_t size() const
+    {
+        return mValues.size();
+    }
+
+    const T& operator[](std::size_t i) const
+    {
+        return mValues[i];
+    }
+
+    template<typename GetBox>
+    Bounds<Float, D> getBounds(std::size_t i, const GetBox& getBox) const
+    {
+        return Bounds<Float, D>::fromBox(getBox(mValues[i]));
+    }
+
+    void push_back(const T& value, const Bounds<Float, D>&)
+    {
+        mValues.push_back(value);
+    }
+
+    void append(const ValueVector& other)
+    {
+        mValues.insert(std::end(mValues), std::begin(other.mValues), std::end(other.mValues));
+    }
+
+    void reserve(std::size_t n)
+    {
+        mValues.reserve(n);
+    }
+
+    // Heap memory in bytes
+    std::size_t getMemoryUsage() const
+    {
+        return mValues.capacity() * sizeof(T);
+    }
+
+    void clear()
+    {
+        mValues.clear();
+    }
+
+    void swap(ValueVector& other)
+    {
+        mValues.swap(other.mValues);
+    }
+
+    // Swap with the last element and pop back
+    void erase(std::size_t i)
+    {
+        assert(i < mValues.size());
+        mValues[i] = std::move(mValues.back());
+        mValues.pop_back();
+    }
+
+private:
+    std::vector<T, typename std::allocator_traits<Allocator>::template rebind_alloc<T>> mValues;
+};
+
+// The bounds of the values are stored next to them in structure-of-arrays
+// layout so that intersection tests do not have to call GetBox
+template<typename T, typename Float, typename Allocator = std::allocator<T>>
+class CachedValueVector
+{
+public:
+    CachedValueVector() = default;
+
+    explicit CachedValueVector(const Allocator& allocator) :
+        mValues(allocator), mLefts(allocator), mTops(allocator), mRights(allocator), mBottoms(allocator)
+    {
+
+    }
+
+    std::size_t size() const
+    {
+        return mValues.size();
+    }
+
+    const T& operator[](std::size_t i) const
+    {
+        return mValues[i];
+    }
+
+    template<typename GetBox>
+    Bounds<Float> getBounds(std::size_t i, const GetBox&) const
+    {
+        return Bounds<Float>{mLefts[i], mTops[i], mRights[i], mBottoms[i]};
+    }
+
+    BoundsArrays<Float> getBoundsArrays() const
+    {
+        return BoundsArrays<Float>{mLefts.data(), mTops.data(), mRights.data(), mBottoms.data()};
+    }
+
+    void setBounds(std::size_t i, const Bounds<Float>& bounds)
+    {
+        mLefts[i] = bounds.left;
+        mTops[i] = bounds.top;
+        mRights[i] = bounds.right;
+        mBottoms[i] = bounds.bottom;
+    }
+
+    void push_back(const T& value, const Bounds<Float>& bounds)
+    {
+        mValues.push_back(value);
+        mLefts.push_back(bounds.left);
+        mTops.push_back(bounds.top);
+        mRights.push_back(bounds.right);
+        mBottoms.push_back(bounds.bottom);
+    }
+
+    void append(const CachedValueVector& other)
+    {
+        mValues.insert(std::end(mValues), std::begin(other.mValues), std::end(other.mValues));
+        mLefts.insert(std::end(mLefts), std::begin(other.mLefts), std::end(other.mLefts));
+        mTops.insert(std::end(mTops), std::begin(other.mTops), std::end(other.mTops));
+        mRights.insert(std::end(mRights), std::begin(other.mRights), std::end(other.mRights));
+        mBottoms.insert(std::end(mBottoms), std::begin(other.mBottoms), std::end(other.mBottoms));
+    }
+
+    void reserve(std::size_t n)
+    {
+        mValues.reserve(n);
+        mLefts.reserve(n);
+        mTops.reserve(n);
+        mRights.reserve(n);
+        mBottoms.reserve(n);
+    }
+
+    // Heap memory in bytes
+    std::size_t getMemoryUsage() const
+    {
+        return mValues.capacity() * sizeof(T) + (mLefts.capacity() + mTops.capacity() + mRights.capacity() +
+            mBottoms.capacity()) * sizeof(Float);
+    }
+
+    void clear()
+    {
+        mValues.clear();
+        mLefts.clear();
+        mTops.clear();
+        mRights.clear();
+        mBottoms.clear();
+    }
+
+    void swap(CachedValueVector& other)
+    {
+        mValues.swap(other.mValues);
+        mLefts.swap(other.mLefts);
+        mTops.swap(other.mTops);
+        mRights.swap(other.mRights);
+        mBottoms.swap(other.mBottoms);
+    }
+
+    // Swap with the last element and pop back
+    void erase(std::size_t i)
+    {
+        assert(i < mValues.size());
+        mValues[i] = std::move(mValues.back());
+        mValues.pop_back();
+        mLefts[i] = mLefts.back();
+        mLefts.pop_back();
+        mTops[i] = mTops.back();
+        mTops.pop_back();
+        mRights[i] = mRights.back();
+        mRights.pop_back();
+        mBottoms[i] = mBottoms.back();
+        mBottoms.pop_back();
+    }
+
+private:
+    template<typename U>
+    using Vector = std::vector<U, typename std::allocator_traits<Allocator>::template rebind_alloc<U>>;
+
+    Vector<T> mValues;
+    Vector<Float> mLefts;
+    Vector<Float> mTops;
+    Vector<Float> mRights;
+    Vector<Float> mBottoms;
+};
+
+// Values stores the values and HandleValueVector stores the index of the
+// handle of each of them next to them
+template<typename Values, typename T, typename Float, typename Allocator = std::allocator<T>>
+class HandleValueVector : public Values
+{
+public:
+    HandleValueVector() = default;
+
+    explicit HandleValueVector(const Allocator& allocator) : Values(allocator), mHandles(allocator)
+    {
+
+    }
+
+    std::uint32_t getHandle(std::size_t i) const
+    {
+        return mHandles[i];
+    }
+
+    void push_back(const T& value, const Bounds<Float>& bounds, std::uint32_t handle)
+    {
+        Values::push_back(value, bounds);
+        mHandles.push_back(handle);
+    }
+
+    void append(const HandleValueVector& other)
+    {
+        Values::append(other);
+        mHandles.insert(std::end(mHandles), std::begin(other.mHandles), std::end(other.mHandles));
+    }
+
+    void reserve(std::size_t n)
+    {
+        Values::reserve(n);
+        mHandles.reserve(n);
+    }
+
+    // Heap memory in bytes
+    std::size_t getMemoryUsage() const
+    {
+        return Values::getMemoryUsage() + mHandles.capacity() * sizeof(std::uint32_t);
+    }
+
+    void clear()
+    {
+        Values::clear();
+        mHandles.clear();
+    }
+
+    void swap(HandleValueVector& other)
+    {
+        Values::swap(other);
+        mHandles.swap(other.mHandles);
+    }
+
+    // Swap with the last element and pop back
+    void erase(std::size_t i)
+    {
+        Values::erase(i);
+        mHandles[i] = mHandles.back();
+        mHandles.pop_back();
+    }
+
+private:
+    std::vector<std::uint32_t, typename std::allocator_traits<Allocator>::template rebind_alloc<std::uint32_t>> mHandles;
+};
+
+}
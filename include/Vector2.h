@@ -1,47 +1,195 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+
 namespace quadtree
 {
 
+// Vector with D coordinates, the vectors of dimension 2 and 3 name their
+// coordinates, all of them are accessed by axis with operator[]
+template<typename T, std::size_t D>
+class Vector
+{
+public:
+    std::array<T, D> coordinates = {};
+
+    constexpr T& operator[](std::size_t axis) noexcept
+    {
+        return coordinates[axis];
+    }
+
+    constexpr const T& operator[](std::size_t axis) const noexcept
+    {
+        return coordinates[axis];
+    }
+
+    constexpr Vector& operator+=(const Vector& other) noexcept
+    {
+        for (auto axis = std::size_t(0); axis < D; ++axis)
+            coordinates[axis] += other.coordinates[axis];
+        return *this;
+    }
+
+    constexpr Vector& operator/=(T t) noexcept
+    {
+        for (auto& coordinate : coordinates)
+            coordinate /= t;
+        return *this;
+    }
+};
+
 template<typename T>
-class Vector2
+class Vector<T, 2>
 {
 public:
     T x;
     T y;
 
-    constexpr Vector2<T>(T X = 0, T Y = 0) noexcept : x(X), y(Y)
+    constexpr Vector(T X = 0, T Y = 0) noexcept : x(X), y(Y)
+    {
+
+    }
+
+    constexpr T& operator[](std::size_t axis) noexcept
+    {
+        return axis == 0 ? x : y;
+    }
+
+    constexpr const T& operator[](std::size_t axis) const noexcept
+    {
+        return axis == 0 ? x : y;
+    }
+
+    constexpr Vector& operator+=(const Vector& other) noexcept
+    {
+        x += other.x;
+        y += other.y;
+        return *this;
+    }
+
+    constexpr Vector& operator/=(T t) noexcept
+    {
+        x /= t;
+        y /= t;
+        return *this;
+    }
+};
+
+template<typename T>
+class Vector<T, 3>
+{
+public:
+    T x;
+    T y;
+    T z;
+
+    constexpr Vector(T X = 0, T Y = 0, T Z = 0) noexcept : x(X), y(Y), z(Z)
+    {
+
+    }
+
+    constexpr T& operator[](std::size_t axis) noexcept
     {
+        return axis == 0 ? x : (axis == 1 ? y : z);
+    }
 
+    constexpr const T& operator[](std::size_t axis) const noexcept
+    {
+        return axis == 0 ? x : (axis == 1 ? y : z);
     }
 
-    constexpr Vector2<T>& operator+=(const Vector2<T>& other) noexcept
+    constexpr Vector& operator+=(const Vector& other) noexcept
     {
         x += other.x;
         y += other.y;
+        z += other.z;
         return *this;
     }
 
-    constexpr Vector2<T>& operator/=(T t) noexcept
+    constexpr Vector& operator/=(T t) noexcept
     {
         x /= t;
         y /= t;
+        z /= t;
         return *this;
     }
 };
 
+// Vector2 and Vector3 are classes rather than aliases so that their template
+// arguments can be deduced from their coordinates, e.g. Vector2(1.0f, 2.0f)
 template<typename T>
-constexpr Vector2<T> operator+(Vector2<T> lhs, const Vector2<T>& rhs) noexcept
+class Vector2 : public Vector<T, 2>
+{
+public:
+    constexpr Vector2(T X = 0, T Y = 0) noexcept : Vector<T, 2>(X, Y)
+    {
+
+    }
+
+    constexpr Vector2(const Vector<T, 2>& vec) noexcept : Vector<T, 2>(vec)
+    {
+
+    }
+};
+
+template<typename T>
+Vector2(T, T) -> Vector2<T>;
+
+template<typename T>
+class Vector3 : public Vector<T, 3>
+{
+public:
+    constexpr Vector3(T X = 0, T Y = 0, T Z = 0) noexcept : Vector<T, 3>(X, Y, Z)
+    {
+
+    }
+
+    constexpr Vector3(const Vector<T, 3>& vec) noexcept : Vector<T, 3>(vec)
+    {
+
+    }
+};
+
+template<typename T>
+Vector3(T, T, T) -> Vector3<T>;
+
+template<typename T, std::size_t D>
+constexpr Vector<T, D> operator+(Vector<T, D> lhs, const Vector<T, D>& rhs) noexcept
 {
     lhs += rhs;
     return lhs;
 }
 
-template<typename T>
-constexpr Vector2<T> operator/(Vector2<T> vec, T t) noexcept
+template<typename T, std::size_t D>
+constexpr Vector<T, D> operator/(Vector<T, D> vec, T t) noexcept
 {
     vec /= t;
     return vec;
 }
 
+template<typename T>
+constexpr Vector2<T> operator+(const Vector2<T>& lhs, const Vector2<T>& rhs) noexcept
+{
+    return Vector<T, 2>(lhs) + rhs;
+}
+
+template<typename T>
+constexpr Vector2<T> operator/(const Vector2<T>& vec, T t) noexcept
+{
+    return Vector<T, 2>(vec) / t;
+}
+
+template<typename T>
+constexpr Vector3<T> operator+(const Vector3<T>& lhs, const Vector3<T>& rhs) noexcept
+{
+    return Vector<T, 3>(lhs) + rhs;
+}
+
+template<typename T>
+constexpr Vector3<T> operator/(const Vector3<T>& vec, T t) noexcept
+{
+    return Vector<T, 3>(vec) / t;
+}
+
 }
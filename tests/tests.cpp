@@ -1,5 +1,20 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <numeric>
 #include <random>
+#include <set>
+#include <sstream>
+#include <thread>
 #include "gtest/gtest.h"
+#include "ConcurrentQuadtree.h"
+#include "DoubleBufferedSnapshot.h"
+#include "IntersectionTracker.h"
+#include "LinearQuadtree.h"
+#include "LooseQuadtree.h"
+#include "MappedFile.h"
+#include "Orthtree.h"
 #include "Quadtree.h"
 
 using namespace quadtree;
@@ -90,31 +105,18 @@ bool checkIntersections(std::vector<std::pair<Node*, Node*>> intersections1,
     return intersections1 == intersections2;
 }
 
-class QuadtreeTest : public ::testing::TestWithParam<std::size_t>
+auto getBox = [](Node* node)
 {
-protected:
-    QuadtreeTest()
-    {
-
-    }
-
-    ~QuadtreeTest() override
-    {
-
-    }
+    return node->box;
 };
 
-TEST_P(QuadtreeTest, AddAndQueryTest)
+template<typename Storage, bool CacheBoxes = false>
+void checkAddAndQuery(std::size_t n)
 {
-    auto n = GetParam();
-    auto getBox = [](Node* node)
-    {
-        return node->box;
-    };
     auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
     auto nodes = generateRandomNodes(n);
     // Add nodes to quadtree
-    auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
     for (auto& node : nodes)
         quadtree.add(&node);
     // Quadtree
@@ -130,17 +132,13 @@ TEST_P(QuadtreeTest, AddAndQueryTest)
         ASSERT_TRUE(checkIntersections(intersections1[node.id], intersections2[node.id]));
 }
 
-TEST_P(QuadtreeTest, AddAndFindAllIntersectionsTest)
+template<typename Storage, bool CacheBoxes = false>
+void checkAddAndFindAllIntersections(std::size_t n)
 {
-    auto n = GetParam();
-    auto getBox = [](Node* node)
-    {
-        return node->box;
-    };
     auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
     auto nodes = generateRandomNodes(n);
     // Add nodes to quadtree
-    auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
     for (auto& node : nodes)
         quadtree.add(&node);
     // Quadtree
@@ -151,17 +149,13 @@ TEST_P(QuadtreeTest, AddAndFindAllIntersectionsTest)
     ASSERT_TRUE(checkIntersections(intersections1, intersections2));
 }
 
-TEST_P(QuadtreeTest, AddRemoveAndQueryTest)
+template<typename Storage, bool CacheBoxes = false>
+void checkAddRemoveAndQuery(std::size_t n)
 {
-    auto n = GetParam();
-    auto getBox = [](Node* node)
-    {
-        return node->box;
-    };
     auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
     auto nodes = generateRandomNodes(n);
     // Add nodes to quadtree
-    auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
     for (auto& node : nodes)
         quadtree.add(&node);
     // Randomly remove some nodes
@@ -199,17 +193,13 @@ TEST_P(QuadtreeTest, AddRemoveAndQueryTest)
     }
 }
 
-TEST_P(QuadtreeTest, AddRemoveAndFindAllIntersectionsTest)
+template<typename Storage, bool CacheBoxes = false>
+void checkAddRemoveAndFindAllIntersections(std::size_t n)
 {
-    auto n = GetParam();
-    auto getBox = [](Node* node)
-    {
-        return node->box;
-    };
     auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
     auto nodes = generateRandomNodes(n);
     // Add nodes to quadtree
-    auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
     for (auto& node : nodes)
         quadtree.add(&node);
     // Randomly remove some nodes
@@ -231,8 +221,1890 @@ TEST_P(QuadtreeTest, AddRemoveAndFindAllIntersectionsTest)
     ASSERT_TRUE(checkIntersections(intersections1, intersections2));
 }
 
-INSTANTIATE_TEST_CASE_P(SmallValues, QuadtreeTest, ::testing::Range(1ul, 200ul));
-INSTANTIATE_TEST_CASE_P(Power10, QuadtreeTest, ::testing::Values(1, 10, 100, 1000, 10000));
+template<typename Storage, bool CacheBoxes = false>
+void checkAddRemoveAddAndFindAllIntersections(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    // Add nodes to quadtree
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Randomly remove some nodes then add them back to reuse the freed nodes
+    auto generator = std::default_random_engine();
+    auto deathDistribution = std::uniform_int_distribution(0, 1);
+    auto removed = std::vector<bool>(nodes.size());
+    std::generate(std::begin(removed), std::end(removed),
+        [&generator, &deathDistribution](){ return deathDistribution(generator); });
+    for (auto& node : nodes)
+    {
+        if (removed[node.id])
+            quadtree.remove(&node);
+    }
+    for (auto& node : nodes)
+    {
+        if (removed[node.id])
+            quadtree.add(&node);
+    }
+    // Quadtree
+    auto intersections1 = quadtree.findAllIntersections();
+    // Brute force
+    auto intersections2 = findAllIntersections(nodes, {});
+    // Check
+    ASSERT_TRUE(checkIntersections(intersections1, intersections2));
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkAddAndFindAllIntersectionsInParallel(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    // Add nodes to quadtree
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Quadtree
+    auto pool = ThreadPool(4);
+    auto intersections1 = quadtree.findAllIntersections(pool);
+    // Brute force
+    auto intersections2 = findAllIntersections(nodes, {});
+    // Check
+    ASSERT_TRUE(checkIntersections(intersections1, intersections2));
+}
+
+// Dense cluster ending up in a single node at the maximum depth and values
+// crossing the horizontal center line staying in the root, so that the
+// large nodes are swept
+template<typename Storage, bool CacheBoxes = false>
+void checkClusterFindAllIntersections(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(2 * n);
+    for (auto i = std::size_t(0); i < n; ++i)
+    {
+        nodes[i].box.left = 0.5f + nodes[i].box.left * 0.0001f;
+        nodes[i].box.top = 0.5f + nodes[i].box.top * 0.0001f;
+        nodes[i].box.width *= 0.001f;
+        nodes[i].box.height *= 0.001f;
+        nodes[n + i].box.top = 0.5f - nodes[n + i].box.height * 0.5f;
+    }
+    // Add nodes to quadtree
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Quadtree
+    auto intersections1 = quadtree.findAllIntersections();
+    auto pool = ThreadPool(4);
+    auto intersections2 = quadtree.findAllIntersections(pool);
+    // Brute force
+    auto intersections3 = findAllIntersections(nodes, {});
+    // Check
+    ASSERT_TRUE(checkIntersections(intersections1, intersections3));
+    ASSERT_TRUE(checkIntersections(intersections2, intersections3));
+    auto count = std::size_t(0);
+    auto stopped = !quadtree.findAllIntersections([&count](Node*, Node*){ return ++count < 10; });
+    ASSERT_EQ(stopped, intersections3.size() >= 10);
+    ASSERT_EQ(count, std::min(intersections3.size(), std::size_t(10)));
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkJoin(std::size_t n)
+{
+    using QuadtreeType = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes,
+        DynamicParameters>;
+    // The second tree has another box and is deeper
+    auto box1 = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto box2 = Box(0.5f, 0.25f, 1.0f, 1.0f);
+    auto nodes1 = generateRandomNodes(n);
+    auto nodes2 = generateRandomNodes(2 * n);
+    for (auto& node : nodes2)
+    {
+        node.box.left += 0.5f;
+        node.box.top += 0.25f;
+    }
+    auto quadtree1 = QuadtreeType(box1, getBox, std::equal_to<Node*>(), DynamicParameters(16, 8));
+    for (auto& node : nodes1)
+        quadtree1.add(&node);
+    auto quadtree2 = QuadtreeType(box2, getBox, std::equal_to<Node*>(), DynamicParameters(4, 12));
+    for (auto& node : nodes2)
+        quadtree2.add(&node);
+    // Brute force
+    auto intersections = std::vector<std::pair<Node*, Node*>>();
+    for (auto& node1 : nodes1)
+    {
+        for (auto& node2 : nodes2)
+        {
+            if (node1.box.intersects(node2.box))
+                intersections.emplace_back(&node1, &node2);
+        }
+    }
+    // Join
+    auto intersections1 = quadtree1.findIntersections(quadtree2);
+    ASSERT_TRUE(checkIntersections(intersections1, intersections));
+    for (const auto& [node1, node2] : intersections1)
+    {
+        ASSERT_TRUE(node1 >= nodes1.data() && node1 < nodes1.data() + nodes1.size());
+        ASSERT_TRUE(node2 >= nodes2.data() && node2 < nodes2.data() + nodes2.size());
+    }
+    auto intersections2 = std::vector<std::pair<Node*, Node*>>();
+    quadtree2.findIntersections(quadtree1, std::back_inserter(intersections2));
+    ASSERT_TRUE(checkIntersections(intersections2, intersections));
+    auto count = std::size_t(0);
+    auto stopped = !quadtree1.findIntersections(quadtree2, [&count](Node*, Node*){ return ++count < 10; });
+    ASSERT_EQ(stopped, intersections.size() >= 10);
+    ASSERT_EQ(count, std::min(intersections.size(), std::size_t(10)));
+    // Join with a tree of another kind whose values are the indices of the nodes
+    auto getIndexBox = [&nodes2](std::size_t i)
+    {
+        return nodes2[i].box;
+    };
+    auto indexQuadtree = Quadtree<std::size_t, decltype(getIndexBox), std::equal_to<std::size_t>, float,
+        PooledStorage>(box2, getIndexBox);
+    for (auto i = std::size_t(0); i < nodes2.size(); ++i)
+        indexQuadtree.add(i);
+    auto intersections3 = std::vector<std::pair<Node*, Node*>>();
+    for (const auto& [node1, i] : quadtree1.findIntersections(indexQuadtree))
+        intersections3.emplace_back(node1, &nodes2[i]);
+    ASSERT_TRUE(checkIntersections(intersections3, intersections));
+    auto intersections4 = std::vector<std::pair<Node*, Node*>>();
+    indexQuadtree.findIntersections(quadtree1, [&intersections4, &nodes2](std::size_t i, Node* node1)
+    {
+        intersections4.emplace_back(node1, &nodes2[i]);
+    });
+    ASSERT_TRUE(checkIntersections(intersections4, intersections));
+}
+
+// Nodes with 64-bit integer coordinates in a box with odd sizes whose
+// quadrants are not all of the same size
+template<typename Storage, bool CacheBoxes = false>
+void checkIntegerCoordinates(std::size_t n)
+{
+    struct IntegerNode
+    {
+        Box<std::int64_t> box;
+        std::size_t id;
+    };
+    auto getIntegerBox = [](IntegerNode* node)
+    {
+        return node->box;
+    };
+    auto box = Box<std::int64_t>(-1000000007, 3, 2000000011, 1999999999);
+    auto generator = std::default_random_engine();
+    auto originDistribution = std::uniform_int_distribution<std::int64_t>(0, box.width - 1);
+    auto sizeDistribution = std::uniform_int_distribution<std::int64_t>(0, box.width / 100);
+    auto nodes = std::vector<IntegerNode>(n);
+    for (auto i = std::size_t(0); i < n; ++i)
+    {
+        nodes[i].box.left = box.left + originDistribution(generator);
+        nodes[i].box.top = box.top + originDistribution(generator) % box.height;
+        nodes[i].box.width = std::min(box.getRight() - nodes[i].box.left, sizeDistribution(generator));
+        nodes[i].box.height = std::min(box.getBottom() - nodes[i].box.top, sizeDistribution(generator));
+        nodes[i].id = i;
+    }
+    // Some nodes touch the center lines of their ancestors
+    for (auto i = std::size_t(0); i < n; i += 3)
+    {
+        auto center = box.getCenter();
+        nodes[i].box.left = center.x - nodes[i].box.width;
+        nodes[i].box.top = center.y;
+    }
+    auto queryNodes = [&nodes](const Box<std::int64_t>& queryBox, const std::vector<bool>& removed)
+    {
+        auto intersections = std::vector<IntegerNode*>();
+        for (auto& node : nodes)
+        {
+            if ((removed.empty() || !removed[node.id]) && queryBox.intersects(node.box))
+                intersections.push_back(&node);
+        }
+        std::sort(std::begin(intersections), std::end(intersections));
+        return intersections;
+    };
+    auto sortPairs = [](std::vector<std::pair<IntegerNode*, IntegerNode*>> pairs)
+    {
+        for (auto& pair : pairs)
+        {
+            if (pair.first > pair.second)
+                std::swap(pair.first, pair.second);
+        }
+        std::sort(std::begin(pairs), std::end(pairs));
+        return pairs;
+    };
+    // Add nodes to quadtree
+    auto quadtree = Quadtree<IntegerNode*, decltype(getIntegerBox), std::equal_to<IntegerNode*>, std::int64_t, Storage,
+        CacheBoxes, StaticParameters<4, 16>>(box, getIntegerBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Query
+    for (const auto& node : nodes)
+    {
+        auto values = quadtree.query(node.box);
+        std::sort(std::begin(values), std::end(values));
+        ASSERT_EQ(values, queryNodes(node.box, {}));
+    }
+    // Find all intersections
+    auto intersections = std::vector<std::pair<IntegerNode*, IntegerNode*>>();
+    for (auto i = std::size_t(0); i < n; ++i)
+    {
+        for (auto j = std::size_t(0); j < i; ++j)
+        {
+            if (nodes[i].box.intersects(nodes[j].box))
+                intersections.emplace_back(&nodes[i], &nodes[j]);
+        }
+    }
+    ASSERT_EQ(sortPairs(quadtree.findAllIntersections()), sortPairs(intersections));
+    // Remove half of the nodes
+    auto removed = std::vector<bool>(n, false);
+    for (auto& node : nodes)
+    {
+        if (node.id % 2 == 0)
+        {
+            quadtree.remove(&node);
+            removed[node.id] = true;
+        }
+    }
+    for (const auto& node : nodes)
+    {
+        auto values = quadtree.query(node.box);
+        std::sort(std::begin(values), std::end(values));
+        ASSERT_EQ(values, queryNodes(node.box, removed));
+    }
+}
+
+template<std::size_t D, typename Storage>
+void checkOrthtree(std::size_t n)
+{
+    struct OrthtreeNode
+    {
+        Box<float, D> box;
+        std::size_t id;
+    };
+    auto getOrthtreeBox = [](OrthtreeNode* node)
+    {
+        return node->box;
+    };
+    auto position = Vector<float, D>();
+    auto size = Vector<float, D>();
+    for (auto axis = std::size_t(0); axis < D; ++axis)
+        size[axis] = 1.0f;
+    auto box = Box<float, D>(position, size);
+    auto generator = std::default_random_engine();
+    auto originDistribution = std::uniform_real_distribution(0.0f, 1.0f);
+    auto sizeDistribution = std::uniform_real_distribution(0.0f, 0.05f);
+    auto nodes = std::vector<OrthtreeNode>(n);
+    for (auto i = std::size_t(0); i < n; ++i)
+    {
+        for (auto axis = std::size_t(0); axis < D; ++axis)
+        {
+            position[axis] = originDistribution(generator);
+            size[axis] = std::min(1.0f - position[axis], sizeDistribution(generator));
+        }
+        nodes[i] = OrthtreeNode{Box<float, D>(position, size), i};
+    }
+    auto queryNodes = [&nodes](const Box<float, D>& queryBox, const std::vector<bool>& removed)
+    {
+        auto intersections = std::vector<OrthtreeNode*>();
+        for (auto& node : nodes)
+        {
+            if ((removed.empty() || !removed[node.id]) && queryBox.intersects(node.box))
+                intersections.push_back(&node);
+        }
+        std::sort(std::begin(intersections), std::end(intersections));
+        return intersections;
+    };
+    auto sortPairs = [](std::vector<std::pair<OrthtreeNode*, OrthtreeNode*>> pairs)
+    {
+        for (auto& pair : pairs)
+        {
+            if (pair.first > pair.second)
+                std::swap(pair.first, pair.second);
+        }
+        std::sort(std::begin(pairs), std::end(pairs));
+        return pairs;
+    };
+    // Add nodes to the tree
+    auto orthtree = Orthtree<OrthtreeNode*, decltype(getOrthtreeBox), D, std::equal_to<OrthtreeNode*>, float, Storage>(
+        box, getOrthtreeBox);
+    for (auto& node : nodes)
+        orthtree.add(&node);
+    // Query
+    for (const auto& node : nodes)
+    {
+        auto values = orthtree.query(node.box);
+        std::sort(std::begin(values), std::end(values));
+        ASSERT_EQ(values, queryNodes(node.box, {}));
+    }
+    // Find all intersections
+    auto intersections = std::vector<std::pair<OrthtreeNode*, OrthtreeNode*>>();
+    for (auto i = std::size_t(0); i < n; ++i)
+    {
+        for (auto j = std::size_t(0); j < i; ++j)
+        {
+            if (nodes[i].box.intersects(nodes[j].box))
+                intersections.emplace_back(&nodes[i], &nodes[j]);
+        }
+    }
+    ASSERT_EQ(sortPairs(orthtree.findAllIntersections()), sortPairs(intersections));
+    // Remove half of the nodes
+    auto removed = std::vector<bool>(n, false);
+    for (auto& node : nodes)
+    {
+        if (node.id % 2 == 0)
+        {
+            orthtree.remove(&node);
+            removed[node.id] = true;
+        }
+    }
+    for (const auto& node : nodes)
+    {
+        auto values = orthtree.query(node.box);
+        std::sort(std::begin(values), std::end(values));
+        ASSERT_EQ(values, queryNodes(node.box, removed));
+    }
+    // Move the remaining nodes
+    auto moveDistribution = std::uniform_real_distribution(-0.1f, 0.1f);
+    for (auto& node : nodes)
+    {
+        if (!removed[node.id])
+        {
+            auto oldBox = node.box;
+            for (auto axis = std::size_t(0); axis < D; ++axis)
+            {
+                position[axis] = std::clamp(oldBox.getPosition()[axis] + moveDistribution(generator), 0.0f,
+                    1.0f - oldBox.getSize()[axis]);
+            }
+            node.box = Box<float, D>(position, oldBox.getSize());
+            orthtree.update(&node, oldBox);
+        }
+    }
+    for (const auto& node : nodes)
+    {
+        auto values = orthtree.query(node.box);
+        std::sort(std::begin(values), std::end(values));
+        ASSERT_EQ(values, queryNodes(node.box, removed));
+    }
+    ASSERT_EQ(orthtree.getStats().nbValues, n / 2);
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkAddAndQueryBatch(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    // Add nodes to quadtree
+    using NodeQuadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>;
+    auto quadtree = NodeQuadtree(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Quadtree, run the batch twice to check that the buffers are correctly reused
+    auto boxes = std::vector<Box<float>>();
+    for (const auto& node : nodes)
+        boxes.push_back(node.box);
+    auto pool = ThreadPool(4);
+    auto result = typename NodeQuadtree::QueryBatchResult();
+    quadtree.queryBatch(std::vector<Box<float>>(std::begin(boxes), std::begin(boxes) + static_cast<std::ptrdiff_t>(n / 2)),
+        pool, result);
+    quadtree.queryBatch(boxes, pool, result);
+    ASSERT_EQ(result.size(), n);
+    auto intersections1 = std::vector<std::vector<Node*>>(nodes.size());
+    for (const auto& node : nodes)
+        intersections1[node.id] = std::vector<Node*>(result.begin(node.id), result.end(node.id));
+    // Brute force
+    auto intersections2 = std::vector<std::vector<Node*>>(nodes.size());
+    for (const auto& node : nodes)
+        intersections2[node.id] = query(node.box, nodes, {});
+    // Check
+    for (const auto& node : nodes)
+        ASSERT_TRUE(checkIntersections(intersections1[node.id], intersections2[node.id]));
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkVisitors(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    // Add nodes to quadtree
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Query
+    for (const auto& node : nodes)
+    {
+        auto intersections = query(node.box, nodes, {});
+        // Visitor
+        auto count = std::size_t(0);
+        ASSERT_TRUE(quadtree.query(node.box, [&count](Node*){ ++count; }));
+        ASSERT_EQ(count, intersections.size());
+        // Visitor with early exit, the node intersects itself so there is at least one intersection
+        count = 0;
+        ASSERT_FALSE(quadtree.query(node.box, [&count](Node*){ ++count; return false; }));
+        ASSERT_EQ(count, 1);
+        // Output iterator
+        auto values = std::vector<Node*>();
+        quadtree.query(node.box, std::back_inserter(values));
+        ASSERT_TRUE(checkIntersections(values, intersections));
+    }
+    // Find all intersections
+    auto intersections1 = std::vector<std::pair<Node*, Node*>>();
+    ASSERT_TRUE(quadtree.findAllIntersections([&intersections1](Node* node1, Node* node2)
+    {
+        intersections1.emplace_back(node1, node2);
+    }));
+    auto intersections2 = findAllIntersections(nodes, {});
+    ASSERT_TRUE(checkIntersections(intersections1, intersections2));
+    auto count = std::size_t(0);
+    auto stopped = !quadtree.findAllIntersections([&count](Node*, Node*){ return ++count < 10; });
+    ASSERT_EQ(stopped, intersections2.size() >= 10);
+    ASSERT_EQ(count, std::min(intersections2.size(), std::size_t(10)));
+    auto intersections3 = std::vector<std::pair<Node*, Node*>>();
+    quadtree.findAllIntersections(std::back_inserter(intersections3));
+    ASSERT_TRUE(checkIntersections(intersections3, intersections2));
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkBulkLoad(std::size_t n, bool parallel)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    // Build the quadtree at once
+    using NodeQuadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>;
+    auto pointers = std::vector<Node*>();
+    for (auto& node : nodes)
+        pointers.push_back(&node);
+    auto pool = ThreadPool(4);
+    auto quadtree = parallel ?
+        NodeQuadtree(box, std::begin(pointers), std::end(pointers), pool, getBox) :
+        NodeQuadtree(box, std::begin(pointers), std::end(pointers), getBox);
+    // Find all intersections
+    auto intersections1 = quadtree.findAllIntersections();
+    auto intersections2 = findAllIntersections(nodes, {});
+    ASSERT_TRUE(checkIntersections(intersections1, intersections2));
+    // Randomly remove some nodes to check that the tree can still be modified
+    auto generator = std::default_random_engine();
+    auto deathDistribution = std::uniform_int_distribution(0, 1);
+    auto removed = std::vector<bool>(nodes.size());
+    std::generate(std::begin(removed), std::end(removed),
+        [&generator, &deathDistribution](){ return deathDistribution(generator); });
+    for (auto& node : nodes)
+    {
+        if (removed[node.id])
+            quadtree.remove(&node);
+    }
+    // Query
+    for (const auto& node : nodes)
+    {
+        if (!removed[node.id])
+        {
+            ASSERT_TRUE(checkIntersections(quadtree.query(node.box), query(node.box, nodes, removed)));
+        }
+    }
+}
+
+void checkLinearQuadtree(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    // Add half of the nodes at once and the other half one by one
+    using NodeQuadtree = LinearQuadtree<Node*, decltype(getBox)>;
+    auto pointers = std::vector<Node*>();
+    for (auto& node : nodes)
+        pointers.push_back(&node);
+    auto middle = std::begin(pointers) + static_cast<std::ptrdiff_t>(n / 2);
+    auto quadtree = NodeQuadtree(box, std::begin(pointers), middle, getBox);
+    for (auto it = middle; it != std::end(pointers); ++it)
+        quadtree.add(*it);
+    // Query
+    for (const auto& node : nodes)
+        ASSERT_TRUE(checkIntersections(quadtree.query(node.box), query(node.box, nodes, {})));
+    // Find all intersections
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, {})));
+    // Randomly remove some nodes
+    auto generator = std::default_random_engine();
+    auto deathDistribution = std::uniform_int_distribution(0, 1);
+    auto removed = std::vector<bool>(nodes.size());
+    std::generate(std::begin(removed), std::end(removed),
+        [&generator, &deathDistribution](){ return deathDistribution(generator); });
+    for (auto& node : nodes)
+    {
+        if (removed[node.id])
+            quadtree.remove(&node);
+    }
+    // Query
+    for (const auto& node : nodes)
+    {
+        if (!removed[node.id])
+        {
+            ASSERT_TRUE(checkIntersections(quadtree.query(node.box), query(node.box, nodes, removed)));
+        }
+    }
+    // Find all intersections
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, removed)));
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkAddUpdateAndFindAllIntersections(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    // Add nodes to quadtree
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Move most nodes by a small amount and some nodes far away
+    auto generator = std::default_random_engine();
+    auto moveDistribution = std::uniform_real_distribution(-0.01f, 0.01f);
+    auto teleportDistribution = std::uniform_int_distribution(0, 9);
+    auto newNodes = generateRandomNodes(2 * n);
+    for (auto& node : nodes)
+    {
+        auto oldBox = node.box;
+        if (teleportDistribution(generator) == 0)
+            node.box = newNodes[n + node.id].box;
+        else
+        {
+            node.box.left = std::clamp(node.box.left + moveDistribution(generator), 0.0f, 1.0f - node.box.width);
+            node.box.top = std::clamp(node.box.top + moveDistribution(generator), 0.0f, 1.0f - node.box.height);
+        }
+        quadtree.update(&node, oldBox);
+    }
+    // Query
+    for (const auto& node : nodes)
+        ASSERT_TRUE(checkIntersections(quadtree.query(node.box), query(node.box, nodes, {})));
+    // Find all intersections
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, {})));
+    // Check that the values can still be removed
+    for (auto& node : nodes)
+        quadtree.remove(&node);
+    ASSERT_TRUE(quadtree.query(box).empty());
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkIntersectionTracker(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    auto values = std::vector<Node*>();
+    // Add nodes to quadtree
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
+    for (auto& node : nodes)
+    {
+        quadtree.add(&node);
+        values.push_back(&node);
+    }
+    // Track the pairs from the added and removed pairs
+    auto tracker = IntersectionTracker<Node*>();
+    auto pairs = std::set<std::pair<Node*, Node*>>();
+    auto addedPairs = std::vector<std::pair<Node*, Node*>>();
+    auto removedPairs = std::vector<std::pair<Node*, Node*>>();
+    auto applyChanges = [&]()
+    {
+        for (auto [node1, node2] : removedPairs)
+            ASSERT_EQ(pairs.erase(std::minmax(node1, node2)), 1);
+        for (auto [node1, node2] : addedPairs)
+            ASSERT_TRUE(pairs.insert(std::minmax(node1, node2)).second);
+        addedPairs.clear();
+        removedPairs.clear();
+    };
+    tracker.update(quadtree, std::begin(values), std::end(values), std::back_inserter(addedPairs),
+        std::back_inserter(removedPairs));
+    ASSERT_TRUE(removedPairs.empty());
+    applyChanges();
+    ASSERT_TRUE(checkIntersections(std::vector(std::begin(pairs), std::end(pairs)), findAllIntersections(nodes, {})));
+    // Move some nodes and remove others
+    auto generator = std::default_random_engine();
+    auto actionDistribution = std::uniform_int_distribution(0, 9);
+    auto moveDistribution = std::uniform_real_distribution(-0.01f, 0.01f);
+    auto removed = std::vector<bool>(n, false);
+    for (auto step = 0; step < 3; ++step)
+    {
+        auto movedValues = std::vector<Node*>();
+        for (auto& node : nodes)
+        {
+            if (removed[node.id])
+                continue;
+            auto action = actionDistribution(generator);
+            if (action < 2)
+            {
+                auto oldBox = node.box;
+                node.box.left = std::clamp(node.box.left + moveDistribution(generator), 0.0f, 1.0f - node.box.width);
+                node.box.top = std::clamp(node.box.top + moveDistribution(generator), 0.0f, 1.0f - node.box.height);
+                quadtree.update(&node, oldBox);
+                movedValues.push_back(&node);
+            }
+            else if (action == 2)
+            {
+                quadtree.remove(&node);
+                tracker.remove(&node, std::back_inserter(removedPairs));
+                removed[node.id] = true;
+            }
+        }
+        tracker.update(quadtree, std::begin(movedValues), std::end(movedValues), std::back_inserter(addedPairs),
+            std::back_inserter(removedPairs));
+        applyChanges();
+        auto trackedPairs = std::vector<std::pair<Node*, Node*>>();
+        tracker.forEachPair([&trackedPairs](Node* node1, Node* node2){ trackedPairs.emplace_back(node1, node2); });
+        ASSERT_EQ(tracker.size(), pairs.size());
+        ASSERT_TRUE(checkIntersections(trackedPairs, std::vector(std::begin(pairs), std::end(pairs))));
+        ASSERT_TRUE(checkIntersections(std::vector(std::begin(pairs), std::end(pairs)),
+            findAllIntersections(nodes, removed)));
+    }
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkFindNearest(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    // Add nodes to quadtree
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto boxDistance = [](Node* node, const Vector2<float>& point)
+    {
+        return Bounds<float>::fromBox(node->box).getDistance(point);
+    };
+    auto centerDistance = [](Node* node, const Vector2<float>& point)
+    {
+        auto center = node->box.getCenter();
+        return std::hypot(center.x - point.x, center.y - point.y);
+    };
+    // Ties make the order of values undefined so only distances are compared
+    auto getDistances = [](const std::vector<Node*>& values, const Vector2<float>& point, const auto& distance)
+    {
+        auto distances = std::vector<float>();
+        for (auto value : values)
+            distances.push_back(distance(value, point));
+        return distances;
+    };
+    auto bruteForce = [&nodes](const Vector2<float>& point, std::size_t k, float maxDistance, const auto& distance)
+    {
+        auto distances = std::vector<float>();
+        for (auto& node : nodes)
+        {
+            if (distance(&node, point) <= maxDistance)
+                distances.push_back(distance(&node, point));
+        }
+        std::sort(std::begin(distances), std::end(distances));
+        distances.resize(std::min(k, distances.size()));
+        return distances;
+    };
+    // The number of points is limited to keep brute force fast
+    auto points = generateRandomNodes(std::min(n, std::size_t(50)));
+    for (const auto& pointNode : points)
+    {
+        auto point = pointNode.box.getTopLeft();
+        for (auto k : {std::size_t(1), std::size_t(5), n + 1})
+        {
+            for (auto maxDistance : {0.01f, std::numeric_limits<float>::max()})
+            {
+                ASSERT_EQ(getDistances(quadtree.findNearest(point, k, maxDistance), point, boxDistance),
+                    bruteForce(point, k, maxDistance, boxDistance));
+                ASSERT_EQ(getDistances(quadtree.findNearest(point, k, maxDistance, centerDistance), point, centerDistance),
+                    bruteForce(point, k, maxDistance, centerDistance));
+            }
+        }
+    }
+}
+
+// With integer coordinates, the distances are exact and do not go through a
+// truncated square root
+void checkIntegerFindNearest(std::size_t n)
+{
+    struct IntegerNode
+    {
+        Box<std::int64_t> box;
+        std::size_t id;
+    };
+    auto getIntegerBox = [](IntegerNode* node)
+    {
+        return node->box;
+    };
+    auto box = Box<std::int64_t>(0, 0, 128, 128);
+    auto generator = std::default_random_engine();
+    auto originDistribution = std::uniform_int_distribution<std::int64_t>(0, 126);
+    auto nodes = std::vector<IntegerNode>(n);
+    for (auto i = std::size_t(0); i < n; ++i)
+        nodes[i] = IntegerNode{Box<std::int64_t>(originDistribution(generator), originDistribution(generator), 1, 1), i};
+    auto quadtree = Quadtree<IntegerNode*, decltype(getIntegerBox), std::equal_to<IntegerNode*>, std::int64_t>(
+        box, getIntegerBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto getSquaredDistance = [](const IntegerNode* node, const Vector2<std::int64_t>& point)
+    {
+        return Bounds<std::int64_t>::fromBox(node->box).getSquaredDistance(point);
+    };
+    for (auto i = 0; i < 50; ++i)
+    {
+        auto point = Vector2(originDistribution(generator), originDistribution(generator));
+        for (auto k : {std::size_t(1), std::size_t(5), n + 1})
+        {
+            for (auto maxDistance : {std::int64_t(3), std::numeric_limits<std::int64_t>::max()})
+            {
+                auto distances = std::vector<std::int64_t>();
+                for (auto value : quadtree.findNearest(point, k, maxDistance))
+                    distances.push_back(getSquaredDistance(value, point));
+                // Brute force
+                auto expectedDistances = std::vector<std::int64_t>();
+                for (const auto& node : nodes)
+                {
+                    auto distance = getSquaredDistance(&node, point);
+                    if (maxDistance == std::numeric_limits<std::int64_t>::max() || distance <= maxDistance * maxDistance)
+                        expectedDistances.push_back(distance);
+                }
+                std::sort(std::begin(expectedDistances), std::end(expectedDistances));
+                expectedDistances.resize(std::min(k, expectedDistances.size()));
+                ASSERT_EQ(distances, expectedDistances);
+            }
+        }
+    }
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkRaycast(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    // Add nodes to quadtree
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto generator = std::default_random_engine();
+    auto originDistribution = std::uniform_real_distribution(-0.5f, 1.5f);
+    auto directionDistribution = std::uniform_real_distribution(-1.0f, 1.0f);
+    auto directions = std::vector<Vector2<float>>{{1.0f, 0.0f}, {0.0f, -1.0f}};
+    // The number of rays is limited to keep brute force fast
+    for (auto i = std::size_t(0); i < std::min(n, std::size_t(50)); ++i)
+        directions.emplace_back(directionDistribution(generator), directionDistribution(generator));
+    for (const auto& direction : directions)
+    {
+        auto origin = Vector2<float>(originDistribution(generator), originDistribution(generator));
+        for (auto maxT : {0.5f, std::numeric_limits<float>::max()})
+        {
+            // Brute force
+            auto hits = std::vector<std::pair<float, Node*>>();
+            for (auto& node : nodes)
+            {
+                auto t = 0.0f;
+                if (Bounds<float>::fromBox(node.box).intersects(origin, direction, maxT, t))
+                    hits.emplace_back(t, &node);
+            }
+            // All hits
+            auto quadtreeHits = std::vector<std::pair<float, Node*>>();
+            ASSERT_FALSE(quadtree.raycast(origin, direction, maxT, [&quadtreeHits](Node* node, float t)
+            {
+                quadtreeHits.emplace_back(t, node);
+                return false;
+            }));
+            ASSERT_TRUE(std::is_sorted(std::begin(quadtreeHits), std::end(quadtreeHits),
+                [](const auto& lhs, const auto& rhs){ return lhs.first < rhs.first; }));
+            std::sort(std::begin(hits), std::end(hits));
+            std::sort(std::begin(quadtreeHits), std::end(quadtreeHits));
+            ASSERT_EQ(quadtreeHits, hits);
+            // First hit
+            auto hit = quadtree.raycast(origin, direction, maxT);
+            ASSERT_EQ(hit.has_value(), !hits.empty());
+            if (hit)
+            {
+                auto t = 0.0f;
+                Bounds<float>::fromBox((*hit)->box).intersects(origin, direction, maxT, t);
+                ASSERT_EQ(t, hits.front().first);
+            }
+        }
+    }
+}
+
+template<typename Parameters>
+void checkParameters(std::size_t n, const Parameters& parameters)
+{
+    using QuadtreeType = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, true, Parameters>;
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    auto values = std::vector<Node*>();
+    for (auto& node : nodes)
+        values.push_back(&node);
+    // Add nodes to quadtree
+    auto quadtree = QuadtreeType(box, getBox, std::equal_to<Node*>(), parameters);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto bulkQuadtree = QuadtreeType(box, std::begin(values), std::end(values), getBox, std::equal_to<Node*>(),
+        parameters);
+    // Find all intersections
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, {})));
+    ASSERT_TRUE(checkIntersections(bulkQuadtree.findAllIntersections(), findAllIntersections(nodes, {})));
+    // Remove half of the nodes
+    auto removed = std::vector<bool>(n, false);
+    for (auto& node : nodes)
+    {
+        if (node.id % 2 == 0)
+        {
+            quadtree.remove(&node);
+            removed[node.id] = true;
+        }
+    }
+    // Query and find all intersections
+    for (const auto& node : nodes)
+        ASSERT_TRUE(checkIntersections(quadtree.query(node.box), query(node.box, nodes, removed)));
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, removed)));
+}
+
+// Values packed in a tiny corner of a huge box make the tree reach its
+// maximum depth, maxDepth is larger than MaxSupportedDepth so it is clamped
+void checkMaxSupportedDepth(std::size_t n)
+{
+    struct IntegerNode
+    {
+        Box<std::int64_t> box;
+        std::size_t id;
+    };
+    auto getIntegerBox = [](IntegerNode* node)
+    {
+        return node->box;
+    };
+    using QuadtreeType = Quadtree<IntegerNode*, decltype(getIntegerBox), std::equal_to<IntegerNode*>, std::int64_t,
+        PooledStorage, true, DynamicParameters>;
+    auto parameters = DynamicParameters(1, 40);
+    ASSERT_EQ(parameters.getMaxDepth(), MaxSupportedDepth);
+    auto box = Box<std::int64_t>(0, 0, std::int64_t(1) << 40, std::int64_t(1) << 40);
+    auto generator = std::default_random_engine();
+    auto originDistribution = std::uniform_int_distribution<std::int64_t>(0, 63);
+    auto nodes = std::vector<IntegerNode>(n);
+    for (auto i = std::size_t(0); i < n; ++i)
+        nodes[i] = IntegerNode{Box<std::int64_t>(originDistribution(generator), originDistribution(generator), 2, 2), i};
+    auto quadtree = QuadtreeType(box, getIntegerBox, std::equal_to<IntegerNode*>(), parameters);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    if (n > 1)
+    {
+        ASSERT_EQ(quadtree.getStats().nbNodesPerDepth.size(), MaxSupportedDepth + 1);
+    }
+    // Query and find all intersections
+    auto nbIntersections = std::size_t(0);
+    for (auto& node : nodes)
+    {
+        auto expected = std::vector<IntegerNode*>();
+        for (auto& other : nodes)
+        {
+            if (node.box.intersects(other.box))
+                expected.push_back(&other);
+        }
+        nbIntersections += expected.size() - 1;
+        auto values = quadtree.query(node.box);
+        std::sort(std::begin(values), std::end(values));
+        ASSERT_EQ(values, expected);
+    }
+    ASSERT_EQ(quadtree.findAllIntersections().size() * 2, nbIntersections);
+}
+
+template<typename Storage>
+void checkLooseQuadtree(std::size_t n, float looseness)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    // Add nodes to quadtree
+    auto quadtree = LooseQuadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage>(box, getBox,
+        std::equal_to<Node*>(), looseness);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Query and find all intersections
+    for (const auto& node : nodes)
+        ASSERT_TRUE(checkIntersections(quadtree.query(node.box), query(node.box, nodes, {})));
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, {})));
+    // Remove half of the nodes
+    auto removed = std::vector<bool>(n, false);
+    for (auto& node : nodes)
+    {
+        if (node.id % 2 == 0)
+        {
+            quadtree.remove(&node);
+            removed[node.id] = true;
+        }
+    }
+    // Query and find all intersections
+    for (const auto& node : nodes)
+        ASSERT_TRUE(checkIntersections(quadtree.query(node.box), query(node.box, nodes, removed)));
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, removed)));
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkStats(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    // Add nodes to quadtree
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    auto sum = [](const std::vector<std::size_t>& counts)
+    {
+        return std::accumulate(std::begin(counts), std::end(counts), std::size_t(0));
+    };
+    // Stats
+    auto stats = quadtree.getStats();
+    ASSERT_EQ(stats.nbValues, n);
+    ASSERT_EQ(stats.nbNodes, 1 + 4 * (stats.nbNodes - stats.nbLeaves));
+    ASSERT_EQ(sum(stats.nbNodesPerDepth), stats.nbNodes);
+    ASSERT_EQ(sum(stats.nbValuesPerDepth), n);
+    ASSERT_EQ(sum(stats.nbNodesPerValueCount), stats.nbNodes);
+    ASSERT_LE(stats.nbValuesInInteriorNodes, n);
+    ASSERT_GT(stats.memoryUsage, std::size_t(0));
+    // Counters
+    auto counters = quadtree.getCounters();
+    ASSERT_EQ(counters.nbSplits, stats.nbNodes - stats.nbLeaves);
+    ASSERT_EQ(counters.nbAllocations, counters.nbSplits);
+    ASSERT_GE(counters.nbNodesVisited, n);
+    quadtree.resetCounters();
+    quadtree.query(box);
+    counters = quadtree.getCounters();
+    ASSERT_EQ(counters.nbNodesVisited, stats.nbNodes);
+    ASSERT_EQ(counters.nbBoxesTested, n + 4 * (stats.nbNodes - stats.nbLeaves));
+    ASSERT_EQ(counters.nbSplits, 0);
+    // Remove all the nodes
+    quadtree.resetCounters();
+    for (auto& node : nodes)
+        quadtree.remove(&node);
+    counters = quadtree.getCounters();
+    ASSERT_EQ(counters.nbMerges, stats.nbNodes - stats.nbLeaves);
+    stats = quadtree.getStats();
+    ASSERT_EQ(stats.nbNodes, 1);
+    ASSERT_EQ(stats.nbValues, 0);
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkSnapshot(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    // Add nodes to quadtree
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Write the snapshot in an aligned buffer
+    auto out = std::ostringstream();
+    quadtree.writeSnapshot(out);
+    auto data = out.str();
+    struct alignas(SnapshotAlignment) Block
+    {
+        char bytes[SnapshotAlignment];
+    };
+    auto buffer = std::vector<Block>(data.size() / sizeof(Block) + 1);
+    std::memcpy(buffer.data(), data.data(), data.size());
+    auto snapshot = SnapshotQuadtree<Node*>(buffer.data(), data.size());
+    ASSERT_EQ(snapshot.size(), n);
+    // Query and find all intersections
+    for (const auto& node : nodes)
+        ASSERT_TRUE(checkIntersections(snapshot.query(node.box), query(node.box, nodes, {})));
+    ASSERT_TRUE(checkIntersections(snapshot.findAllIntersections(), findAllIntersections(nodes, {})));
+    // Invalid snapshots
+    ASSERT_THROW(SnapshotQuadtree<Node*>(buffer.data(), data.size() - 1), std::runtime_error);
+    ASSERT_THROW(SnapshotQuadtree<std::uint32_t>(buffer.data(), data.size()), std::runtime_error);
+    // Map the snapshot from a file
+    auto path = std::filesystem::temp_directory_path() / "quadtree_snapshot_test.bin";
+    {
+        auto file = std::ofstream(path, std::ios::binary);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+    {
+        auto file = MappedFile(path.string());
+        auto mappedSnapshot = SnapshotQuadtree<Node*>(file.getData(), file.getSize());
+        ASSERT_TRUE(checkIntersections(mappedSnapshot.findAllIntersections(), findAllIntersections(nodes, {})));
+    }
+    std::filesystem::remove(path);
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkDoubleBufferedSnapshot(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes>(box, getBox);
+    auto snapshot = DoubleBufferedSnapshot<Node*>(box);
+    // Empty before the first publication
+    ASSERT_EQ(snapshot.acquire()->query(box).size(), 0);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    snapshot.publish(quadtree);
+    auto view1 = snapshot.acquire();
+    // Randomly remove some nodes and publish again
+    auto generator = std::default_random_engine();
+    auto deathDistribution = std::uniform_int_distribution(0, 1);
+    auto removed = std::vector<bool>(nodes.size());
+    std::generate(std::begin(removed), std::end(removed),
+        [&generator, &deathDistribution](){ return deathDistribution(generator); });
+    for (auto& node : nodes)
+    {
+        if (removed[node.id])
+            quadtree.remove(&node);
+    }
+    snapshot.publish(quadtree);
+    auto view2 = snapshot.acquire();
+    // The first view still sees the tree as it was when it was published
+    for (const auto& node : nodes)
+    {
+        ASSERT_TRUE(checkIntersections(view1->query(node.box), query(node.box, nodes, {})));
+        ASSERT_TRUE(checkIntersections(view2->query(node.box), query(node.box, nodes, removed)));
+    }
+    ASSERT_TRUE(checkIntersections(view1->findAllIntersections(), findAllIntersections(nodes, {})));
+    ASSERT_TRUE(checkIntersections(view2->findAllIntersections(), findAllIntersections(nodes, removed)));
+    // Rebuilding the snapshot of a tree of the same size reuses the buffers
+    auto buffers = SnapshotBuffers<Node*, float>();
+    quadtree.buildSnapshot(buffers);
+    auto nodesData = buffers.nodes.data();
+    auto valuesData = buffers.values.data();
+    quadtree.buildSnapshot(buffers);
+    ASSERT_EQ(buffers.nodes.data(), nodesData);
+    ASSERT_EQ(buffers.values.data(), valuesData);
+}
+
+void checkDoubleBufferedSnapshotReadersAndWriter(std::size_t n, std::size_t nbReaders)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    auto quadtree = Quadtree<Node*, decltype(getBox)>(box, getBox);
+    auto snapshot = DoubleBufferedSnapshot<Node*>(box);
+    // Each tick adds the next node, readers check that a snapshot contains the first nodes
+    auto done = std::atomic<bool>(false);
+    auto nbErrors = std::atomic<std::size_t>(0);
+    auto readers = std::vector<std::thread>();
+    for (auto i = std::size_t(0); i < nbReaders; ++i)
+    {
+        readers.emplace_back([&]()
+        {
+            while (!done.load())
+            {
+                auto view = snapshot.acquire();
+                auto values = view->query(box);
+                auto valid = values.size() == view->size() && std::all_of(std::begin(values), std::end(values),
+                    [&](Node* node){ return node->id < values.size(); });
+                if (!valid)
+                    ++nbErrors;
+            }
+        });
+    }
+    for (auto& node : nodes)
+    {
+        quadtree.add(&node);
+        snapshot.publish(quadtree);
+    }
+    done.store(true);
+    for (auto& reader : readers)
+        reader.join();
+    ASSERT_EQ(nbErrors.load(), 0);
+    ASSERT_EQ(snapshot.acquire()->size(), n);
+}
+
+// Memory resource counting the memory allocated through it
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    std::size_t getNbAllocations() const
+    {
+        return mNbAllocations;
+    }
+
+    std::size_t getNbBytes() const
+    {
+        return mNbBytes;
+    }
+
+private:
+    std::size_t mNbAllocations = 0;
+    std::size_t mNbBytes = 0; // Allocated and not deallocated yet
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        ++mNbAllocations;
+        mNbBytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        mNbBytes -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+template<typename Storage, bool CacheBoxes = false>
+void checkAllocator(std::size_t n, std::pmr::memory_resource* resource)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    auto allocator = std::pmr::polymorphic_allocator<Node*>(resource);
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes,
+        StaticParameters<>, std::pmr::polymorphic_allocator<Node*>>(box, getBox, std::equal_to<Node*>(),
+        StaticParameters<>(), allocator);
+    ASSERT_EQ(quadtree.getAllocator(), allocator);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Randomly remove some nodes
+    auto generator = std::default_random_engine();
+    auto deathDistribution = std::uniform_int_distribution(0, 1);
+    auto removed = std::vector<bool>(nodes.size());
+    std::generate(std::begin(removed), std::end(removed),
+        [&generator, &deathDistribution](){ return deathDistribution(generator); });
+    for (auto& node : nodes)
+    {
+        if (removed[node.id])
+            quadtree.remove(&node);
+    }
+    // Check
+    for (const auto& node : nodes)
+    {
+        if (!removed[node.id])
+        {
+            ASSERT_TRUE(checkIntersections(quadtree.query(node.box), query(node.box, nodes, removed)));
+        }
+    }
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, removed)));
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkAllocator(std::size_t n)
+{
+    // All the memory of the tree comes from the resource and is given back to it
+    auto countingResource = CountingResource();
+    checkAllocator<Storage, CacheBoxes>(n, &countingResource);
+    ASSERT_GT(countingResource.getNbAllocations(), 0);
+    ASSERT_EQ(countingResource.getNbBytes(), 0);
+    // Standard resources
+    auto monotonicResource = std::pmr::monotonic_buffer_resource();
+    checkAllocator<Storage, CacheBoxes>(n, &monotonicResource);
+    auto poolResource = std::pmr::unsynchronized_pool_resource();
+    checkAllocator<Storage, CacheBoxes>(n, &poolResource);
+}
+
+// The parallel bulk load shares the allocator between the threads
+template<typename Storage, bool CacheBoxes = false>
+void checkParallelBulkLoadAllocator(std::size_t n, std::pmr::memory_resource* resource)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    auto pointers = std::vector<Node*>();
+    for (auto& node : nodes)
+        pointers.push_back(&node);
+    auto pool = ThreadPool(4);
+    auto allocator = std::pmr::polymorphic_allocator<Node*>(resource);
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes,
+        StaticParameters<4>, std::pmr::polymorphic_allocator<Node*>>(box, std::begin(pointers), std::end(pointers),
+        pool, getBox, std::equal_to<Node*>(), StaticParameters<4>(), allocator);
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, {})));
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkParallelBulkLoadAllocator(std::size_t n)
+{
+    // CountingResource is not thread-safe either, concurrent allocations
+    // would make its counts wrong
+    auto countingResource = CountingResource();
+    checkParallelBulkLoadAllocator<Storage, CacheBoxes>(n, &countingResource);
+    ASSERT_EQ(countingResource.getNbBytes(), 0);
+    auto poolResource = std::pmr::unsynchronized_pool_resource();
+    checkParallelBulkLoadAllocator<Storage, CacheBoxes>(n, &poolResource);
+    auto monotonicResource = std::pmr::monotonic_buffer_resource();
+    checkParallelBulkLoadAllocator<Storage, CacheBoxes>(n, &monotonicResource);
+}
+
+// With a small threshold, the parallel bulk load creates many blocks of
+// PooledStorage while other tasks access the nodes
+void checkParallelBulkLoadManyBlocks(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    auto pointers = std::vector<Node*>();
+    for (auto& node : nodes)
+        pointers.push_back(&node);
+    auto pool = ThreadPool(4);
+    auto quadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, PooledStorage, false,
+        StaticParameters<2, 12>>(box, std::begin(pointers), std::end(pointers), pool, getBox);
+    ASSERT_EQ(quadtree.getStats().nbValues, n);
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, {})));
+}
+
+template<typename Storage, bool CacheBoxes = false>
+void checkHandles(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    using HandleQuadtree = Quadtree<Node*, decltype(getBox), std::equal_to<Node*>, float, Storage, CacheBoxes,
+        StaticParameters<>, std::allocator<Node*>, true>;
+    auto quadtree = HandleQuadtree(box, getBox);
+    auto handles = std::vector<Handle>();
+    for (auto& node : nodes)
+        handles.push_back(quadtree.add(&node));
+    for (const auto& node : nodes)
+        ASSERT_EQ(quadtree.getValue(handles[node.id]), &node);
+    // Move some nodes
+    auto generator = std::default_random_engine();
+    auto moveDistribution = std::uniform_real_distribution(-0.1f, 0.1f);
+    for (auto& node : nodes)
+    {
+        if (node.id % 2 == 0)
+            continue;
+        auto oldBox = node.box;
+        node.box.left = std::clamp(node.box.left + moveDistribution(generator), 0.0f, 1.0f - node.box.width);
+        node.box.top = std::clamp(node.box.top + moveDistribution(generator), 0.0f, 1.0f - node.box.height);
+        if constexpr (CacheBoxes)
+            quadtree.update(handles[node.id]);
+        else
+            quadtree.update(handles[node.id], oldBox);
+    }
+    // The handles follow the values when the tree is moved
+    auto movedQuadtree = std::move(quadtree);
+    // Randomly remove some nodes, by handle or by value
+    auto deathDistribution = std::uniform_int_distribution(0, 1);
+    auto removed = std::vector<bool>(nodes.size());
+    std::generate(std::begin(removed), std::end(removed),
+        [&generator, &deathDistribution](){ return deathDistribution(generator); });
+    for (auto& node : nodes)
+    {
+        if (removed[node.id])
+        {
+            if (node.id % 3 == 0)
+                movedQuadtree.remove(&node);
+            else
+                movedQuadtree.remove(handles[node.id]);
+        }
+    }
+    for (const auto& node : nodes)
+    {
+        ASSERT_EQ(movedQuadtree.isValid(handles[node.id]), !removed[node.id]);
+        if (!removed[node.id])
+        {
+            ASSERT_EQ(movedQuadtree.getValue(handles[node.id]), &node);
+            ASSERT_TRUE(checkIntersections(movedQuadtree.query(node.box), query(node.box, nodes, removed)));
+        }
+    }
+    ASSERT_TRUE(checkIntersections(movedQuadtree.findAllIntersections(), findAllIntersections(nodes, removed)));
+    // Removed slots are reused with new handles
+    for (auto& node : nodes)
+    {
+        if (removed[node.id])
+        {
+            auto handle = movedQuadtree.add(&node);
+            ASSERT_NE(handle, handles[node.id]);
+            ASSERT_FALSE(movedQuadtree.isValid(handles[node.id]));
+            handles[node.id] = handle;
+        }
+    }
+    for (auto& node : nodes)
+        movedQuadtree.remove(handles[node.id]);
+    ASSERT_EQ(movedQuadtree.query(box).size(), 0);
+}
+
+void checkConcurrentQuadtree(std::size_t n)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    auto quadtree = ConcurrentQuadtree<Node*, decltype(getBox)>(box, getBox);
+    for (auto& node : nodes)
+        quadtree.add(&node);
+    // Randomly remove some nodes
+    auto generator = std::default_random_engine();
+    auto deathDistribution = std::uniform_int_distribution(0, 1);
+    auto removed = std::vector<bool>(nodes.size());
+    std::generate(std::begin(removed), std::end(removed),
+        [&generator, &deathDistribution](){ return deathDistribution(generator); });
+    for (auto& node : nodes)
+    {
+        if (removed[node.id])
+            quadtree.remove(&node);
+    }
+    // Check the queries and the intersections
+    for (const auto& node : nodes)
+    {
+        if (!removed[node.id])
+        {
+            ASSERT_TRUE(checkIntersections(quadtree.query(node.box), query(node.box, nodes, removed)));
+        }
+    }
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, removed)));
+    // Without reader, everything replaced is deleted
+    ASSERT_EQ(quadtree.getNbRetired(), 0);
+}
+
+void checkConcurrentReadersAndWriter(std::size_t n, std::size_t nbReaders, std::size_t nbWrites)
+{
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    auto nodes = generateRandomNodes(n);
+    auto quadtree = ConcurrentQuadtree<Node*, decltype(getBox)>(box, getBox);
+    // The first half is never removed, the second half is added and removed by the writer
+    auto nbStatic = n / 2;
+    auto removed = std::vector<bool>(n, true);
+    for (auto i = std::size_t(0); i < nbStatic; ++i)
+    {
+        quadtree.add(&nodes[i]);
+        removed[i] = false;
+    }
+    auto staticIntersections = std::vector<std::vector<Node*>>(nbStatic);
+    for (auto i = std::size_t(0); i < nbStatic; ++i)
+        staticIntersections[i] = query(nodes[i].box, nodes, removed);
+    // Readers check that they always see the static nodes and only valid nodes
+    auto done = std::atomic<bool>(false);
+    auto nbErrors = std::atomic<std::size_t>(0);
+    auto readers = std::vector<std::thread>();
+    for (auto i = std::size_t(0); i < nbReaders; ++i)
+    {
+        readers.emplace_back([&, i]()
+        {
+            auto j = i;
+            while (!done.load())
+            {
+                j = (j + 1) % nbStatic;
+                auto result = quadtree.query(nodes[j].box);
+                auto found = std::set<Node*>(std::begin(result), std::end(result));
+                auto valid = found.size() == result.size() && std::all_of(std::begin(result), std::end(result),
+                    [&](Node* node){ return node >= nodes.data() && node < nodes.data() + n &&
+                        node->box.intersects(nodes[j].box); }) &&
+                    std::all_of(std::begin(staticIntersections[j]), std::end(staticIntersections[j]),
+                        [&found](Node* node){ return found.count(node) == 1; });
+                if (!valid)
+                    ++nbErrors;
+            }
+        });
+    }
+    // Writer
+    auto generator = std::default_random_engine();
+    auto dynamicDistribution = std::uniform_int_distribution(nbStatic, n - 1);
+    for (auto i = std::size_t(0); i < nbWrites; ++i)
+    {
+        auto j = dynamicDistribution(generator);
+        if (removed[j])
+            quadtree.add(&nodes[j]);
+        else
+            quadtree.remove(&nodes[j]);
+        removed[j] = !removed[j];
+    }
+    done.store(true);
+    for (auto& reader : readers)
+        reader.join();
+    ASSERT_EQ(nbErrors.load(), 0);
+    // Check the final state
+    ASSERT_TRUE(checkIntersections(quadtree.findAllIntersections(), findAllIntersections(nodes, removed)));
+    // Once the readers are gone, the next write deletes everything replaced
+    quadtree.add(&nodes[n - 1]);
+    quadtree.remove(&nodes[n - 1]);
+    ASSERT_EQ(quadtree.getNbRetired(), 0);
+}
+
+class QuadtreeTest : public ::testing::TestWithParam<std::size_t>
+{
+protected:
+    QuadtreeTest()
+    {
+
+    }
+
+    ~QuadtreeTest() override
+    {
+
+    }
+};
+
+TEST_P(QuadtreeTest, AddAndQueryTest)
+{
+    checkAddAndQuery<PointerStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, AddAndFindAllIntersectionsTest)
+{
+    checkAddAndFindAllIntersections<PointerStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, AddRemoveAndQueryTest)
+{
+    checkAddRemoveAndQuery<PointerStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, AddRemoveAndFindAllIntersectionsTest)
+{
+    checkAddRemoveAndFindAllIntersections<PointerStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, AddRemoveAddAndFindAllIntersectionsTest)
+{
+    checkAddRemoveAddAndFindAllIntersections<PointerStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, PooledAddAndQueryTest)
+{
+    checkAddAndQuery<PooledStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, PooledAddAndFindAllIntersectionsTest)
+{
+    checkAddAndFindAllIntersections<PooledStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, PooledAddRemoveAndQueryTest)
+{
+    checkAddRemoveAndQuery<PooledStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, PooledAddRemoveAndFindAllIntersectionsTest)
+{
+    checkAddRemoveAndFindAllIntersections<PooledStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, PooledAddRemoveAddAndFindAllIntersectionsTest)
+{
+    checkAddRemoveAddAndFindAllIntersections<PooledStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, CachedAddAndQueryTest)
+{
+    checkAddAndQuery<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, CachedAddAndFindAllIntersectionsTest)
+{
+    checkAddAndFindAllIntersections<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, CachedAddRemoveAndQueryTest)
+{
+    checkAddRemoveAndQuery<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, CachedAddRemoveAndFindAllIntersectionsTest)
+{
+    checkAddRemoveAndFindAllIntersections<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, CachedAddRemoveAddAndFindAllIntersectionsTest)
+{
+    checkAddRemoveAddAndFindAllIntersections<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, ParallelAddAndFindAllIntersectionsTest)
+{
+    checkAddAndFindAllIntersectionsInParallel<PointerStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, CachedParallelAddAndFindAllIntersectionsTest)
+{
+    checkAddAndFindAllIntersectionsInParallel<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, ClusterFindAllIntersectionsTest)
+{
+    checkClusterFindAllIntersections<PointerStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, CachedClusterFindAllIntersectionsTest)
+{
+    checkClusterFindAllIntersections<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, JoinTest)
+{
+    checkJoin<PointerStorage>(GetParam());
+    checkJoin<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, IntegerCoordinatesTest)
+{
+    checkIntegerCoordinates<PointerStorage>(GetParam());
+    checkIntegerCoordinates<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, OrthtreeTest)
+{
+    checkOrthtree<2, PointerStorage>(GetParam());
+    checkOrthtree<3, PooledStorage>(GetParam());
+    checkOrthtree<4, PointerStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, AddAndQueryBatchTest)
+{
+    checkAddAndQueryBatch<PointerStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, CachedAddAndQueryBatchTest)
+{
+    checkAddAndQueryBatch<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, VisitorsTest)
+{
+    checkVisitors<PointerStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, CachedVisitorsTest)
+{
+    checkVisitors<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, BulkLoadTest)
+{
+    checkBulkLoad<PointerStorage>(GetParam(), false);
+}
+
+TEST_P(QuadtreeTest, CachedBulkLoadInParallelTest)
+{
+    checkBulkLoad<PooledStorage, true>(GetParam(), true);
+}
+
+TEST_P(QuadtreeTest, LinearQuadtreeTest)
+{
+    checkLinearQuadtree(GetParam());
+}
+
+TEST_P(QuadtreeTest, AddUpdateAndFindAllIntersectionsTest)
+{
+    checkAddUpdateAndFindAllIntersections<PointerStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, CachedAddUpdateAndFindAllIntersectionsTest)
+{
+    checkAddUpdateAndFindAllIntersections<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, IntersectionTrackerTest)
+{
+    checkIntersectionTracker<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, FindNearestTest)
+{
+    checkFindNearest<PointerStorage>(GetParam());
+    checkIntegerFindNearest(GetParam());
+}
+
+TEST_P(QuadtreeTest, CachedFindNearestTest)
+{
+    checkFindNearest<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, RaycastTest)
+{
+    checkRaycast<PointerStorage>(GetParam());
+}
+
+TEST_P(QuadtreeTest, CachedRaycastTest)
+{
+    checkRaycast<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, ParametersTest)
+{
+    checkParameters(GetParam(), StaticParameters<1, 16>());
+    checkParameters(GetParam(), DynamicParameters(64, 4));
+    checkParameters(GetParam(), DynamicParameters(2, 20));
+    checkMaxSupportedDepth(GetParam());
+}
+
+TEST_P(QuadtreeTest, LooseQuadtreeTest)
+{
+    checkLooseQuadtree<PointerStorage>(GetParam(), 1.0f);
+    checkLooseQuadtree<PooledStorage>(GetParam(), 2.0f);
+}
+
+TEST_P(QuadtreeTest, StatsTest)
+{
+    checkStats<PointerStorage>(GetParam());
+    checkStats<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, SnapshotTest)
+{
+    checkSnapshot<PointerStorage>(GetParam());
+    checkSnapshot<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, DoubleBufferedSnapshotTest)
+{
+    checkDoubleBufferedSnapshot<PointerStorage>(GetParam());
+    checkDoubleBufferedSnapshot<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, AllocatorTest)
+{
+    checkAllocator<PointerStorage>(GetParam());
+    checkAllocator<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, ParallelBulkLoadAllocatorTest)
+{
+    checkParallelBulkLoadAllocator<PointerStorage>(GetParam());
+    checkParallelBulkLoadAllocator<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, ParallelBulkLoadManyBlocksTest)
+{
+    checkParallelBulkLoadManyBlocks(GetParam());
+}
+
+TEST_P(QuadtreeTest, HandlesTest)
+{
+    checkHandles<PointerStorage>(GetParam());
+    checkHandles<PooledStorage, true>(GetParam());
+}
+
+TEST_P(QuadtreeTest, ConcurrentQuadtreeTest)
+{
+    checkConcurrentQuadtree(GetParam());
+}
+
+INSTANTIATE_TEST_CASE_P(SmallValues, QuadtreeTest, ::testing::Range(1ul, 200ul));
+INSTANTIATE_TEST_CASE_P(Power10, QuadtreeTest, ::testing::Values(1, 10, 100, 1000, 10000));
+
+#ifdef QUADTREE_SIMD_X86
+
+void checkFindIntersectingBoundsKernel(FindIntersectingBoundsKernel kernel)
+{
+    auto nodes = generateRandomNodes(1000);
+    // Make some boxes share sides to test the boundary cases
+    for (auto i = std::size_t(1); i < nodes.size(); i += 3)
+        nodes[i].box.left = nodes[i - 1].box.getRight();
+    auto lefts = std::vector<float>();
+    auto tops = std::vector<float>();
+    auto rights = std::vector<float>();
+    auto bottoms = std::vector<float>();
+    for (const auto& node : nodes)
+    {
+        lefts.push_back(node.box.left);
+        tops.push_back(node.box.top);
+        rights.push_back(node.box.getRight());
+        bottoms.push_back(node.box.getBottom());
+    }
+    auto boxes = BoundsArrays<float>{lefts.data(), tops.data(), rights.data(), bottoms.data()};
+    auto indices1 = std::vector<std::size_t>(nodes.size());
+    auto indices2 = std::vector<std::size_t>(nodes.size());
+    for (auto i = std::size_t(0); i < nodes.size(); ++i)
+    {
+        // Use unaligned ranges to test the tails
+        auto first = i % 7;
+        auto last = nodes.size() - i % 13;
+        auto bounds = Bounds<float>::fromBox(nodes[i].box);
+        auto count1 = kernel(bounds, boxes, first, last, indices1.data());
+        auto count2 = findIntersectingBoundsScalar(bounds, boxes, first, last, indices2.data());
+        ASSERT_EQ(count1, count2);
+        ASSERT_TRUE(std::equal(std::begin(indices1), std::begin(indices1) + static_cast<std::ptrdiff_t>(count1),
+            std::begin(indices2)));
+    }
+}
+
+TEST(SimdTest, SseTest)
+{
+    if (!__builtin_cpu_supports("sse2"))
+        GTEST_SKIP();
+    checkFindIntersectingBoundsKernel(&findIntersectingBoundsSse);
+}
+
+TEST(SimdTest, Avx2Test)
+{
+    if (!__builtin_cpu_supports("avx2"))
+        GTEST_SKIP();
+    checkFindIntersectingBoundsKernel(&findIntersectingBoundsAvx2);
+}
+
+TEST(SimdTest, Avx512Test)
+{
+    if (!__builtin_cpu_supports("avx512f"))
+        GTEST_SKIP();
+    checkFindIntersectingBoundsKernel(&findIntersectingBoundsAvx512);
+}
+
+#endif
+
+TEST(VectorTest, DeductionTest)
+{
+    // The template arguments of the named vectors are deduced from their coordinates
+    auto vec2 = Vector2(1.0f, 2.0f);
+    static_assert(std::is_same_v<decltype(vec2), Vector2<float>>);
+    static_assert(std::is_same_v<decltype(vec2 + vec2), Vector2<float>>);
+    static_assert(std::is_same_v<decltype(vec2 / 2.0f), Vector2<float>>);
+    auto sum2 = vec2 + Vector2(3.0f, 4.0f);
+    ASSERT_TRUE(sum2.x == 4.0f && sum2.y == 6.0f);
+    auto vec3 = Vector3(1, 2, 3);
+    static_assert(std::is_same_v<decltype(vec3), Vector3<int>>);
+    auto half3 = (vec3 + vec3) / 2;
+    ASSERT_TRUE(half3.x == 1 && half3.y == 2 && half3.z == 3);
+    // The named vectors are the vectors of dimension 2 and 3
+    auto box = Box(Vector2(1.0f, 2.0f), Vector2(3.0f, 4.0f));
+    ASSERT_TRUE(box.getCenter().x == 2.5f && box.getPosition()[1] == 2.0f);
+    auto vec = Vector<float, 2>(vec2);
+    ASSERT_TRUE(vec[0] == 1.0f && vec[1] == 2.0f);
+}
+
+TEST(QuadrantTest, IntegerQuadrantsTest)
+{
+    auto generator = std::default_random_engine();
+    auto distribution = std::uniform_int_distribution<std::int64_t>(1, 1000);
+    for (auto i = 0; i < 1000; ++i)
+    {
+        auto box = Box<std::int64_t>(distribution(generator) - 500, distribution(generator) - 500,
+            distribution(generator), distribution(generator));
+        // The quadrants tile the box exactly
+        auto area = std::int64_t(0);
+        for (auto j = 0; j < 4; ++j)
+        {
+            auto childBox = computeBox(box, j);
+            ASSERT_TRUE(box.contains(childBox));
+            area += childBox.width * childBox.height;
+        }
+        ASSERT_EQ(area, box.width * box.height);
+        ASSERT_EQ(computeBox(box, 0).getRight(), computeBox(box, 1).left);
+        ASSERT_EQ(computeBox(box, 1).getRight(), box.getRight());
+        ASSERT_EQ(computeBox(box, 0).getBottom(), computeBox(box, 2).top);
+        ASSERT_EQ(computeBox(box, 2).getBottom(), box.getBottom());
+        // The quadrant of a value contains it and no quadrant contains a value without quadrant
+        auto left = box.left + distribution(generator) % box.width;
+        auto top = box.top + distribution(generator) % box.height;
+        auto valueBox = Box<std::int64_t>(left, top, distribution(generator) % (box.getRight() - left + 1),
+            distribution(generator) % (box.getBottom() - top + 1));
+        auto quadrant = getQuadrant(box, Bounds<std::int64_t>::fromBox(valueBox));
+        if (quadrant != -1)
+            ASSERT_TRUE(computeBox(box, quadrant).contains(valueBox));
+        else
+        {
+            for (auto j = 0; j < 4; ++j)
+                ASSERT_FALSE(computeBox(box, j).contains(valueBox));
+        }
+    }
+}
+
+TEST(QuadrantTest, OctantsTest)
+{
+    auto generator = std::default_random_engine();
+    auto distribution = std::uniform_int_distribution<std::int64_t>(1, 1000);
+    for (auto i = 0; i < 1000; ++i)
+    {
+        auto box = Box<std::int64_t, 3>(distribution(generator) - 500, distribution(generator) - 500,
+            distribution(generator) - 500, distribution(generator), distribution(generator), distribution(generator));
+        // The octants tile the box exactly
+        auto volume = std::int64_t(0);
+        for (auto j = 0; j < 8; ++j)
+        {
+            auto childBox = computeBox(box, j);
+            ASSERT_TRUE(box.contains(childBox));
+            volume += childBox.width * childBox.height * childBox.depth;
+        }
+        ASSERT_EQ(volume, box.width * box.height * box.depth);
+        // The octant of a value contains it and no octant contains a value without octant
+        auto left = box.left + distribution(generator) % box.width;
+        auto top = box.top + distribution(generator) % box.height;
+        auto front = box.front + distribution(generator) % box.depth;
+        auto valueBox = Box<std::int64_t, 3>(left, top, front, distribution(generator) % (box.getRight() - left + 1),
+            distribution(generator) % (box.getBottom() - top + 1), distribution(generator) % (box.getBack() - front + 1));
+        auto octant = getQuadrant(box, Bounds<std::int64_t, 3>::fromBox(valueBox));
+        if (octant != -1)
+            ASSERT_TRUE(computeBox(box, octant).contains(valueBox));
+        else
+        {
+            for (auto j = 0; j < 8; ++j)
+                ASSERT_FALSE(computeBox(box, j).contains(valueBox));
+        }
+    }
+    // In dimension 2, the generic functions give the same results as the specialized ones
+    auto box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+    for (const auto& node : generateRandomNodes(1000))
+    {
+        auto bounds = Bounds<float>::fromBox(node.box);
+        ASSERT_EQ((getQuadrant<float, 2>(box, bounds)), getQuadrant(box, bounds));
+        auto i = std::max(getQuadrant(box, bounds), 0);
+        auto childBox = computeBox<float, 2>(box, i);
+        ASSERT_TRUE(childBox.left == computeBox(box, i).left && childBox.width == computeBox(box, i).width);
+    }
+}
+
+// The tests are built with QUADTREE_STATS so the trees use the enabled counters
+TEST(StatsTest, DisabledCountersTest)
+{
+    static_assert(std::is_empty_v<AtomicOperationCounters<false>>);
+    auto counters = AtomicOperationCounters<false>();
+    counters.addNodesVisited(10);
+    counters.addBoxesTested(10);
+    counters.addSplit();
+    counters.addMerge();
+    counters.addAllocation();
+    auto copy = counters;
+    auto isZero = [](const OperationCounters& c)
+    {
+        return c.nbNodesVisited == 0 && c.nbBoxesTested == 0 && c.nbSplits == 0 && c.nbMerges == 0 &&
+            c.nbAllocations == 0;
+    };
+    ASSERT_TRUE(isZero(counters.get()));
+    ASSERT_TRUE(isZero(copy.get()));
+    counters.reset();
+    ASSERT_TRUE(isZero(counters.get()));
+    // The enabled counters count and reset
+    auto enabledCounters = AtomicOperationCounters<true>();
+    enabledCounters.addNodesVisited(10);
+    enabledCounters.addSplit();
+    ASSERT_EQ(enabledCounters.get().nbNodesVisited, 10);
+    auto enabledCopy = enabledCounters;
+    ASSERT_EQ(enabledCopy.get().nbSplits, 1);
+    enabledCounters.reset();
+    ASSERT_TRUE(isZero(enabledCounters.get()));
+}
+
+TEST(ConcurrentQuadtreeTest, ReadersAndWriterTest)
+{
+    checkConcurrentReadersAndWriter(2000, 1, 2000);
+    checkConcurrentReadersAndWriter(2000, 4, 5000);
+}
+
+TEST(DoubleBufferedSnapshotTest, ReadersAndWriterTest)
+{
+    checkDoubleBufferedSnapshotReadersAndWriter(2000, 1);
+    checkDoubleBufferedSnapshotReadersAndWriter(2000, 4);
+}
+
+TEST(SnapshotTest, CorruptedNodesTest)
+{
+    struct alignas(SnapshotAlignment) Block
+    {
+        char bytes[SnapshotAlignment];
+    };
+    // Write the nodes in a snapshot without values and load it
+    auto load = [](std::vector<SnapshotNode> nodes)
+    {
+        auto buffers = SnapshotBuffers<std::uint32_t, float>();
+        buffers.box = Box(0.0f, 0.0f, 1.0f, 1.0f);
+        buffers.nodes = std::move(nodes);
+        auto out = std::ostringstream();
+        writeSnapshot(out, buffers);
+        auto data = out.str();
+        auto buffer = std::vector<Block>(data.size() / sizeof(Block) + 1);
+        std::memcpy(buffer.data(), data.data(), data.size());
+        return SnapshotQuadtree<std::uint32_t>(buffer.data(), data.size()).size();
+    };
+    // Chain of nodes, the first child of each node is split
+    auto makeChain = [](std::size_t depth)
+    {
+        auto nodes = std::vector<SnapshotNode>(4 * depth + 1);
+        for (auto i = std::size_t(0); i < depth; ++i)
+            nodes[i == 0 ? 0 : 4 * i - 3].firstChild = static_cast<std::uint32_t>(4 * i + 1);
+        return nodes;
+    };
+    ASSERT_EQ(load(makeChain(MaxSupportedDepth)), 0);
+    // Too deep
+    ASSERT_THROW(load(makeChain(MaxSupportedDepth + 1)), std::runtime_error);
+    ASSERT_THROW(load(makeChain(100000)), std::runtime_error);
+    // Children shared by two nodes
+    auto nodes = std::vector<SnapshotNode>(9);
+    nodes[0].firstChild = 1;
+    nodes[1].firstChild = 5;
+    nodes[2].firstChild = 5;
+    ASSERT_THROW(load(nodes), std::runtime_error);
+    // Children not in depth-first order
+    nodes = std::vector<SnapshotNode>(13);
+    nodes[0].firstChild = 1;
+    nodes[1].firstChild = 9;
+    nodes[2].firstChild = 5;
+    ASSERT_THROW(load(nodes), std::runtime_error);
+    nodes[1].firstChild = 5;
+    nodes[2].firstChild = 9;
+    ASSERT_EQ(load(nodes), 0);
+    // Unreachable nodes
+    nodes.resize(17);
+    ASSERT_THROW(load(nodes), std::runtime_error);
+}
 
 int main(int argc, char **argv)
 {